@@ -0,0 +1,282 @@
+// Accuracy and latency of the OCR classifier backends on a labelled corpus of cells.
+// The classifiers are trained on one corpus and evaluated on another one, e.g. the
+// interactive training files against the held-out sheets of img/ (benchmarks/ocrcorpus.txt):
+//   OCRBench train --xml <classificationDigits.xml> <trainedImages.xml> --synthetic 100
+//            test --manifest ../benchmarks/ocrcorpus.txt --synthetic 50
+// Options (before the corpora):
+//   --classifier <name>     only this backend (default: all registered backends)
+//   --pca <components>      project the cells to compact features first (FeatureProjection)
+//   --min-accuracy <%>      exit code 1 if a backend falls below (regression gate)
+// The labels of the knn backend are checked against cv::ml::KNearest (k = 1), any difference
+// fails the run.
+#include "digitclassifier.h"
+#include "featureprojection.h"
+#include "trainer.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <opencv2/ml.hpp>
+
+namespace
+{
+const int cellWidth = 20;
+const int cellHeight = 30;
+const uint64_t trainingSeed = 0x5eed;
+const uint64_t testSeed = 0x7e57;   // Synthetic test cells differ from the training cells
+const int batchSizes[] = {1, 9, 81, 729};   // Single cell, one box, one sudoku, nine sudokus
+const int cellsPerMeasurement = 20000;
+const int measurements = 3;                 // The best of these counts
+
+void printUsage()
+{
+    std::cout << "Usage:" << std::endl;
+    std::cout << "  OCRBench [--classifier <name>] [--pca <components>] [--min-accuracy <percent>]"
+                 " train <corpus> test <corpus>" << std::endl;
+    std::cout << "  corpus: [--manifest <file>] [--cells <directory>]"
+                 " [--xml <classificationDigits.xml> <trainedImages.xml>] [--synthetic <samplesPerDigit>]" << std::endl;
+}
+
+// Adds the source at argv[i] to the corpus, false if argv[i] is no corpus option
+bool parseCorpusOption(int argc, char *argv[], int& i, Trainer& corpus, const uint64_t seed, bool& ok)
+{
+    const std::string option = argv[i];
+    if(option == "--manifest" && i + 1 < argc)
+        ok = corpus.readManifest(argv[++i]);
+    else if(option == "--cells" && i + 1 < argc)
+        ok = corpus.addCellDirectory(argv[++i]);
+    else if(option == "--xml" && i + 2 < argc)
+    {
+        ok = corpus.readTrainingFiles(argv[i + 1], argv[i + 2]);
+        i += 2;
+    }
+    else if(option == "--synthetic" && i + 1 < argc)
+    {
+        corpus.addSynthetic(std::atoi(argv[++i]), seed);
+        ok = true;
+    }
+    else
+        return false;
+    return true;
+}
+
+// rows cells of the test features, repeated if the corpus is smaller than the batch
+cv::Mat makeBatch(const cv::Mat& samples, const int rows)
+{
+    cv::Mat batch(rows, samples.cols, samples.type());
+    for(int i = 0; i < rows; ++i)
+    {
+        cv::Mat batchRow = batch.row(i);
+        samples.row(i % samples.rows).copyTo(batchRow);
+    }
+    return batch;
+}
+
+// Nanoseconds per cell of classify (including the projection of the cells), best of several runs
+double measure(const DigitClassifier& classifier, const FeatureProjection& projection, const cv::Mat& batch)
+{
+    const int repetitions = std::max(1, cellsPerMeasurement / batch.rows);
+    double best = 0.0;
+    for(int m = 0; m < measurements; ++m)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        for(int r = 0; r < repetitions; ++r)
+        {
+            const cv::Mat features = projection.empty() ? batch : projection.project(batch);
+            classifier.classify(features);
+        }
+        const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() /
+                          (static_cast<double>(repetitions) * batch.rows);
+        best = (m == 0) ? ns : std::min(best, ns);
+    }
+    return best;
+}
+
+// Rows: true digit, columns: predicted digit ('?' for labels outside 1-9)
+void printConfusion(const std::vector<std::vector<int>>& confusion)
+{
+    std::cout << "  true\\pred";
+    for(int p = 0; p < 10; ++p)
+        std::cout << std::setw(5) << (p < 9 ? static_cast<char>('1' + p) : '?');
+    std::cout << std::endl;
+    for(int t = 0; t < 9; ++t)
+    {
+        std::cout << std::setw(11) << static_cast<char>('1' + t);
+        for(int p = 0; p < 10; ++p)
+            std::cout << std::setw(5) << confusion[t][p];
+        std::cout << std::endl;
+    }
+}
+
+// Number of test cells that cv::ml::KNearest (k = 1, brute force) trained on the same features
+// labels differently than the predictions, -1 if KNearest could not be trained
+int countKNearestMismatches(const cv::Mat& trainFeatures, const cv::Mat& trainLabels, const cv::Mat& testFeatures,
+                            const std::vector<CellPrediction>& predictions)
+{
+    cv::Mat trainingImg;
+    cv::Mat classificationImg;
+    trainFeatures.convertTo(trainingImg, CV_32FC1);
+    trainLabels.convertTo(classificationImg, CV_32FC1);
+
+    cv::Ptr<cv::ml::KNearest> knearest = cv::ml::KNearest::create();
+    knearest->setIsClassifier(true);
+    knearest->setAlgorithmType(cv::ml::KNearest::Types::BRUTE_FORCE);
+    knearest->setDefaultK(1);
+    if(!knearest->train(trainingImg, cv::ml::ROW_SAMPLE, classificationImg))
+        return -1;
+
+    cv::Mat testImg;
+    cv::Mat knnResults;
+    testFeatures.convertTo(testImg, CV_32FC1);
+    knearest->findNearest(testImg, 1, knnResults);
+    int mismatches = 0;
+    for(size_t i = 0; i < predictions.size(); ++i)
+    {
+        if(static_cast<int>(knnResults.at<float>(static_cast<int>(i))) != predictions[i].label)
+            ++mismatches;
+    }
+    return mismatches;
+}
+
+// Trains one backend, prints its accuracy (in percent), confusion matrix and latency.
+// Returns false if the backend could not be trained (then accuracy is not set) or, for knn,
+// if its labels differ from those of cv::ml::KNearest.
+bool benchmark(const std::string& name, const Trainer& training, const Trainer& test, const int components, double& accuracy)
+{
+    FeatureProjection projection;
+    cv::Mat trainFeatures = training.samples();
+    if(components > 0)
+    {
+        if(!projection.fit(training.samples(), cellWidth, cellHeight, components))
+        {
+            std::cout << "Error: projection with " << components << " components could not be computed!" << std::endl;
+            return false;
+        }
+        trainFeatures = projection.project(training.samples());
+    }
+
+    std::unique_ptr<DigitClassifier> classifier = ClassifierRegistry::create(name);
+    const auto start = std::chrono::steady_clock::now();
+    if(!classifier || !classifier->train(trainFeatures, training.labels()))
+    {
+        std::cout << "Error: classifier " << name << " could not be trained!" << std::endl;
+        return false;
+    }
+    const double trainMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    const cv::Mat testFeatures = projection.empty() ? test.samples() : projection.project(test.samples());
+    const std::vector<CellPrediction> predictions = classifier->classify(testFeatures);
+    std::vector<std::vector<int>> confusion(9, std::vector<int>(10, 0));
+    int correct = 0;
+    int evaluated = 0;  // Cells labelled with a digit 1-9, others are not counted
+    for(size_t i = 0; i < predictions.size(); ++i)
+    {
+        const int truth = test.labels().at<int>(static_cast<int>(i)) - '1';
+        const int predicted = predictions[i].label - '1';
+        if(truth < 0 || truth > 8)
+            continue;
+        ++evaluated;
+        ++confusion[truth][(predicted >= 0 && predicted <= 8) ? predicted : 9];
+        if(predicted == truth)
+            ++correct;
+    }
+    accuracy = (evaluated == 0) ? 0.0 : 100.0 * correct / evaluated;
+
+    const std::string title = (components > 0) ? name + " (pca " + std::to_string(components) + ")" : name;
+    std::cout << std::endl << title << ": " << correct << "/" << evaluated << " correct ("
+              << std::fixed << std::setprecision(2) << accuracy << " %), trained in "
+              << std::setprecision(0) << trainMs << " ms" << std::endl;
+    printConfusion(confusion);
+
+    std::cout << "  batch";
+    for(const int batchSize : batchSizes)
+        std::cout << std::setw(10) << batchSize;
+    std::cout << std::endl << "  ns/cell";
+    for(const int batchSize : batchSizes)
+        std::cout << std::setw(10) << std::setprecision(0) << measure(*classifier, projection, makeBatch(test.samples(), batchSize));
+    std::cout << std::endl;
+
+    if(name == "knn")
+    {
+        const int mismatches = countKNearestMismatches(trainFeatures, training.labels(), testFeatures, predictions);
+        if(mismatches < 0)
+        {
+            std::cout << "Error: KNearest reference could not be trained!" << std::endl;
+            return false;
+        }
+        std::cout << "  cv::ml::KNearest reference: " << mismatches << " of " << predictions.size() << " labels differ" << std::endl;
+        if(mismatches > 0)
+            return false;
+    }
+    return true;
+}
+}
+
+int main(int argc, char *argv[])
+{
+    Trainer training(cellWidth, cellHeight);
+    Trainer test(cellWidth, cellHeight);
+    Trainer* corpus = nullptr;
+    std::vector<std::string> names;
+    int components = 0;
+    double minAccuracy = 0.0;
+
+    for(int i = 1; i < argc; ++i)
+    {
+        const std::string option = argv[i];
+        bool ok = true;
+        if(option == "train")
+            corpus = &training;
+        else if(option == "test")
+            corpus = &test;
+        else if(corpus == nullptr && option == "--classifier" && i + 1 < argc)
+            names.push_back(argv[++i]);
+        else if(corpus == nullptr && option == "--pca" && i + 1 < argc)
+            components = std::atoi(argv[++i]);
+        else if(corpus == nullptr && option == "--min-accuracy" && i + 1 < argc)
+            minAccuracy = std::atof(argv[++i]);
+        else if(corpus == nullptr || !parseCorpusOption(argc, argv, i, *corpus, corpus == &test ? testSeed : trainingSeed, ok))
+        {
+            printUsage();
+            return 1;
+        }
+
+        if(!ok)
+            return 1;
+    }
+
+    if(training.size() == 0 || test.size() == 0)
+    {
+        printUsage();
+        return 1;
+    }
+    const bool allBackends = names.empty();
+    if(allBackends)
+        names = ClassifierRegistry::names();
+
+    std::cout << "Training cells: " << training.size() << ", test cells: " << test.size() << std::endl;
+    bool passed = true;
+    for(const std::string& name : names)
+    {
+        // Binarising backends only work on the cell pixels
+        if(components > 0 && !ClassifierRegistry::acceptsProjectedFeatures(name))
+        {
+            std::cout << std::endl << name << ": needs the cell pixels, not benchmarked with --pca" << std::endl;
+            passed = passed && allBackends;
+            continue;
+        }
+        double accuracy = 0.0;
+        if(!benchmark(name, training, test, components, accuracy))
+        {
+            std::cout << "  " << name << " failed" << std::endl;
+            passed = false;
+        }
+        else if(accuracy < minAccuracy)
+        {
+            std::cout << "  below the minimum accuracy of " << minAccuracy << " %" << std::endl;
+            passed = false;
+        }
+    }
+    return passed ? 0 : 1;
+}
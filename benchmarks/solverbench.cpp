@@ -0,0 +1,223 @@
+// Benchmark of the solving engines on a shared corpus of 9x9, 16x16 and 25x25 grids.
+// Every solve runs with a time limit, engines that get stuck are cancelled and counted as timeouts.
+// Afterwards a large batch of completed 9x9 grids is checked by the scalar check and by the
+// GridVerifier on PackedGrid storage, both have to agree.
+#include "solver.h"
+#include "gridverifier.h"
+#include <condition_variable>
+#include <random>
+#include <iomanip>
+
+namespace
+{
+const double timeLimit = 10.0;  // seconds per puzzle and engine
+const int verifyGrids = 200000; // completed grids of the bulk check, two cells swapped in every fourth one
+
+struct Puzzle
+{
+    int boxSize;
+    std::vector<int> cells;
+};
+
+std::vector<int> parsePuzzle(const std::string& text)
+{
+    std::vector<int> cells;
+    for(const char el : text)
+        cells.push_back(el == '.' ? 0 : el - '0');
+    return cells;
+}
+
+// Creates a solvable grid: shuffled pattern solution with a share of the cells removed
+std::vector<int> generatePuzzle(const int boxSize, const double givenRatio, std::mt19937& rng)
+{
+    const int N = boxSize * boxSize;
+    std::vector<int> digits(N);
+    for(int i = 0; i < N; ++i)
+        digits[i] = i + 1;
+    std::shuffle(digits.begin(), digits.end(), rng);
+
+    std::vector<int> cells(N * N);
+    for(int row = 0; row < N; ++row)
+    {
+        for(int col = 0; col < N; ++col)
+        {
+            const int pattern = (boxSize * (row % boxSize) + row / boxSize + col) % N;
+            cells[row * N + col] = digits[pattern];
+        }
+    }
+
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    for(auto& el : cells)
+    {
+        if(uniform(rng) > givenRatio)
+            el = 0;
+    }
+    return cells;
+}
+
+bool isSolved(const std::vector<int>& puzzle, const std::vector<int>& givens, const int boxSize)
+{
+    const int N = boxSize * boxSize;
+    for(int i = 0; i < N; ++i)
+    {
+        std::vector<bool> rowSeen(N + 1, false), colSeen(N + 1, false), boxSeen(N + 1, false);
+        for(int j = 0; j < N; ++j)
+        {
+            const int r = puzzle[i * N + j];
+            const int c = puzzle[j * N + i];
+            const int b = puzzle[((i / boxSize) * boxSize + j / boxSize) * N + (i % boxSize) * boxSize + j % boxSize];
+            if(r < 1 || r > N || c < 1 || c > N || b < 1 || b > N || rowSeen[r] || colSeen[c] || boxSeen[b])
+                return false;
+            rowSeen[r] = colSeen[c] = boxSeen[b] = true;
+        }
+    }
+    for(size_t i = 0; i < givens.size(); ++i)
+    {
+        if(givens[i] != 0 && givens[i] != puzzle[i])
+            return false;
+    }
+    return true;
+}
+
+// Times the bulk check of completed 9x9 grids: isSolved on std::vector<int> grids against the
+// GridVerifier on the same grids in a PackedGridArray. False if they disagree on any grid.
+bool benchmarkVerifier(std::mt19937& rng)
+{
+    std::vector<std::vector<int>> grids;
+    PackedGridArray packed;
+    grids.reserve(verifyGrids);
+    packed.reserve(verifyGrids);
+    for(int i = 0; i < verifyGrids; ++i)
+    {
+        std::vector<int> grid = generatePuzzle(3, 1.0, rng);
+        if(i % 4 == 3)
+            std::swap(grid[rng() % 81], grid[rng() % 81]);
+        packed.push_back(grid);
+        grids.push_back(std::move(grid));
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+    std::vector<uint8_t> scalarValid(grids.size());
+    size_t scalarCorrect = 0;
+    for(size_t i = 0; i < grids.size(); ++i)
+    {
+        scalarValid[i] = isSolved(grids[i], std::vector<int>(), 3) ? 1 : 0;
+        scalarCorrect += scalarValid[i];
+    }
+    const double scalarMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+    GridVerifier verifier;
+    std::vector<uint8_t> packedValid;
+    start = std::chrono::high_resolution_clock::now();
+    const size_t packedCorrect = verifier.verify(packed, packedValid);
+    const double packedMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+    std::cout << std::endl << std::left << std::setw(22) << "verify" << std::setw(10) << "valid"
+              << std::setw(14) << "total [ms]" << "bytes/grid" << std::endl;
+    std::cout << std::left << std::setw(22) << "scalar (vector<int>)" << std::setw(10) << scalarCorrect
+              << std::setw(14) << std::fixed << std::setprecision(3) << scalarMs
+              << sizeof(std::vector<int>) + 81 * sizeof(int) << std::endl;
+    std::cout << std::left << std::setw(22) << "GridVerifier (packed)" << std::setw(10) << packedCorrect
+              << std::setw(14) << packedMs << PackedGrid::m_bytes << std::endl;
+
+    if(packedValid != scalarValid)
+    {
+        std::cout << "Error: GridVerifier and the scalar check disagree!" << std::endl;
+        return false;
+    }
+    return true;
+}
+}
+
+int main()
+{
+    // Corpus: well known hard 9x9 puzzles plus generated large grids
+    std::vector<Puzzle> corpus;
+    const std::vector<std::string> classics = {
+        "53..7....6..195....98....6.8...6...34..8.3..17...2...6.6....28....419..5....8..79",
+        "8..........36......7..9.2...5...7.......457.....1...3...1....68..85...1..9....4..",
+        "..53.....8......2..7..1.5..4....53...1..7...6..32...8..6.5....9..4....3......97..",
+        ".....6....59.....82....8....45........3........6..3.54...325..6..................",
+        "4.....8.5.3..........7......2.....6.....8.4......1.......6.3.7.5..2.....1.4......",
+        "1....7.9..3..2...8..96..5....53..9...1..8...26....4...3......1..4......7..7...3.."
+    };
+    for(const auto& el : classics)
+        corpus.push_back({3, parsePuzzle(el)});
+
+    std::mt19937 rng(2021);
+    for(int i = 0; i < 5; ++i)
+        corpus.push_back({4, generatePuzzle(4, 0.45, rng)});
+    for(int i = 0; i < 5; ++i)
+        corpus.push_back({5, generatePuzzle(5, 0.45, rng)});
+
+    const std::vector<SolverEngine> engines = {
+        SolverEngine::Backtracking, SolverEngine::Propagation, SolverEngine::DancingLinks,
+        SolverEngine::CDCL, SolverEngine::Bands
+    };
+
+    std::cout << std::left << std::setw(22) << "engine" << std::setw(8) << "size"
+              << std::setw(8) << "solved" << std::setw(10) << "timeout"
+              << std::setw(14) << "total [ms]" << "max [ms]" << std::endl;
+
+    for(const auto engine : engines)
+    {
+        for(int boxSize = 3; boxSize <= 5; ++boxSize)
+        {
+            // The band kernel only handles 9x9 grids
+            if(engine == SolverEngine::Bands && boxSize != 3)
+                continue;
+
+            int solved = 0;
+            int timeouts = 0;
+            double totalMs = 0.0;
+            double maxMs = 0.0;
+
+            for(const auto& el : corpus)
+            {
+                if(el.boxSize != boxSize)
+                    continue;
+
+                std::vector<int> puzzle(el.cells);
+                Solver solver(boxSize);
+                std::atomic<bool> cancel(false);
+                solver.setCancelFlag(&cancel);
+
+                // Watchdog that cancels the solve once the time limit is exceeded
+                std::mutex mutex;
+                std::condition_variable finished;
+                bool done = false;
+                std::thread watchdog([&]()
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    if(!finished.wait_for(lock, std::chrono::duration<double>(timeLimit), [&](){return done;}))
+                        cancel.store(true);
+                });
+
+                auto start = std::chrono::high_resolution_clock::now();
+                const bool success = solver.solveWith(engine, puzzle);
+                auto finish = std::chrono::high_resolution_clock::now();
+
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    done = true;
+                }
+                finished.notify_one();
+                watchdog.join();
+
+                const double ms = std::chrono::duration<double, std::milli>(finish - start).count();
+                totalMs += ms;
+                maxMs = std::max(maxMs, ms);
+                if(cancel.load())
+                    ++timeouts;
+                else if(success && isSolved(puzzle, el.cells, boxSize))
+                    ++solved;
+            }
+
+            std::cout << std::left << std::setw(22) << Solver::engineName(engine)
+                      << std::setw(8) << (std::to_string(boxSize * boxSize) + "x" + std::to_string(boxSize * boxSize))
+                      << std::setw(8) << solved << std::setw(10) << timeouts
+                      << std::setw(14) << std::fixed << std::setprecision(3) << totalMs << maxMs << std::endl;
+        }
+    }
+    return benchmarkVerifier(rng) ? 0 : 1;
+}
@@ -0,0 +1,343 @@
+#include "bandsolver.h"
+
+namespace
+{
+const uint32_t allCells = 0x7FFFFFF;    // 27 cells of a band
+const uint32_t columnBits = 0x40201;    // Column 0 in all three rows of a band
+
+// Lookup tables shared by all solver instances (built once)
+struct BandTables
+{
+    uint32_t peers[27];         // Row, column and box peers of a cell inside its band
+    uint8_t rowTriads[512];     // 9 cells of a row --> 3 bits "digit possible in box k"
+    uint32_t triadCells[512];   // 3x3 triad pattern --> 27 bit cell mask
+    uint16_t permutations[512]; // Triads that are part of a valid placement (one per row and box)
+
+    BandTables()
+    {
+        for(int bit = 0; bit < 27; ++bit)
+        {
+            const int row = bit / 9;
+            const int col = bit % 9;
+            const uint32_t rowMask = 0x1FFu << (9 * row);
+            const uint32_t colMask = columnBits << col;
+            const uint32_t boxMask = 0x1C0E07u << (3 * (col / 3));
+            peers[bit] = (rowMask | colMask | boxMask) & ~(1u << bit);
+        }
+
+        for(int pattern = 0; pattern < 512; ++pattern)
+        {
+            rowTriads[pattern] = static_cast<uint8_t>(((pattern & 0x7) ? 1 : 0) | ((pattern & 0x38) ? 2 : 0) | ((pattern & 0x1C0) ? 4 : 0));
+
+            triadCells[pattern] = 0;
+            for(int triad = 0; triad < 9; ++triad)
+            {
+                if(pattern & (1 << triad))
+                    triadCells[pattern] |= 0x7u << (9 * (triad / 3) + 3 * (triad % 3));
+            }
+
+            // A digit occupies exactly one triad per row and per box: keep the union of
+            // all six permutation matrices that fit into the pattern
+            permutations[pattern] = 0;
+            const int perms[6][3] = {{0,1,2}, {0,2,1}, {1,0,2}, {1,2,0}, {2,0,1}, {2,1,0}};
+            for(const auto& perm : perms)
+            {
+                const int matrix = (1 << perm[0]) | (1 << (3 + perm[1])) | (1 << (6 + perm[2]));
+                if((pattern & matrix) == matrix)
+                    permutations[pattern] |= static_cast<uint16_t>(matrix);
+            }
+        }
+    }
+};
+
+const BandTables& tables()
+{
+    static const BandTables instance;
+    return instance;
+}
+
+// Triad pattern (row r, box k --> bit 3r+k) of a band
+inline int compressTriads(const BandTables& t, const uint32_t band)
+{
+    return t.rowTriads[band & 0x1FF] | (t.rowTriads[(band >> 9) & 0x1FF] << 3) | (t.rowTriads[band >> 18] << 6);
+}
+
+// Columns (9 bits) in which the band has at least one candidate
+inline uint32_t foldColumns(const uint32_t band)
+{
+    return (band | (band >> 9) | (band >> 18)) & 0x1FF;
+}
+}
+
+BandSolver::BandSolver()
+    : m_cancel(nullptr)
+{}
+
+BandSolver::~BandSolver(){}
+
+// Places the digit: removes the cell from all other digits and the digit from all peers
+void BandSolver::place(State& state, const int digit, const int band, const int bit)
+{
+    const uint32_t cell = 1u << bit;
+    for(int d = 0; d < 9; ++d)
+    {
+        if(d != digit)
+            state.digits[d][band] &= ~cell;
+    }
+
+    state.digits[digit][band] &= ~tables().peers[bit];
+    const uint32_t column = columnBits << (bit % 9);
+    for(int b = 0; b < 3; ++b)
+    {
+        if(b != band)
+            state.digits[digit][b] &= ~column;
+    }
+    state.solved[band] |= cell;
+}
+
+// Runs locked candidates and singles until nothing changes (false on contradiction)
+bool BandSolver::propagate(State& state)
+{
+    const BandTables& t = tables();
+    bool changed = true;
+
+    // Digits whose bands did not change since their last pass are skipped
+    uint32_t seen[9][3] = {};
+
+    while(changed)
+    {
+        changed = false;
+
+        for(int d = 0; d < 9; ++d)
+        {
+            uint32_t* bands = state.digits[d];
+            if(bands[0] == seen[d][0] && bands[1] == seen[d][1] && bands[2] == seen[d][2])
+                continue;
+
+            // 1) Locked candidates along the rows: one triad per row and box of a band
+            for(int b = 0; b < 3; ++b)
+            {
+                bands[b] &= t.triadCells[t.permutations[compressTriads(t, bands[b])]];
+                if(bands[b] == 0)
+                    return false;
+            }
+
+            // 2) Locked candidates along the columns: one column per band and stack
+            const uint32_t folded[3] = {foldColumns(bands[0]), foldColumns(bands[1]), foldColumns(bands[2])};
+            for(int stack = 0; stack < 3; ++stack)
+            {
+                const int shift = 3 * stack;
+                const int pattern = ((folded[0] >> shift) & 0x7) | (((folded[1] >> shift) & 0x7) << 3) | (((folded[2] >> shift) & 0x7) << 6);
+                const int allowed = t.permutations[pattern];
+                if(allowed == 0)
+                    return false;
+                for(int b = 0; b < 3; ++b)
+                {
+                    const uint32_t removedCols = ((~(allowed >> (3 * b)) & 0x7) << shift);
+                    bands[b] &= ~(removedCols * columnBits);
+                }
+            }
+
+            // 3) Hidden singles in rows, boxes and columns
+            for(int b = 0; b < 3; ++b)
+            {
+                for(int r = 0; r < 3; ++r)
+                {
+                    const uint32_t row = bands[b] & (0x1FFu << (9 * r));
+                    if(popCount(row) == 1 && (row & ~state.solved[b]))
+                    {
+                        place(state, d, b, lowestBitIndex(row));
+                        changed = true;
+                    }
+                }
+                for(int k = 0; k < 3; ++k)
+                {
+                    const uint32_t box = bands[b] & (0x1C0E07u << (3 * k));
+                    if(popCount(box) == 1 && (box & ~state.solved[b]))
+                    {
+                        place(state, d, b, lowestBitIndex(box));
+                        changed = true;
+                    }
+                }
+            }
+
+            // Columns with exactly one candidate over all nine rows
+            uint32_t one = 0;
+            uint32_t two = 0;
+            for(int b = 0; b < 3; ++b)
+            {
+                for(int r = 0; r < 3; ++r)
+                {
+                    const uint32_t row = (bands[b] >> (9 * r)) & 0x1FF;
+                    two |= one & row;
+                    one |= row;
+                }
+            }
+            if(one != 0x1FF)
+                return false;
+
+            uint32_t singleCols = one & ~two;
+            while(singleCols)
+            {
+                const uint32_t column = columnBits << lowestBitIndex(singleCols);
+                singleCols &= singleCols - 1;
+                for(int b = 0; b < 3; ++b)
+                {
+                    if(bands[b] & column & ~state.solved[b])
+                    {
+                        place(state, d, b, lowestBitIndex(bands[b] & column));
+                        changed = true;
+                    }
+                }
+            }
+
+            for(int b = 0; b < 3; ++b)
+                seen[d][b] = bands[b];
+        }
+
+        // 4) Naked singles: cells covered by exactly one digit
+        for(int b = 0; b < 3; ++b)
+        {
+            uint32_t one = 0;
+            uint32_t two = 0;
+            for(int d = 0; d < 9; ++d)
+            {
+                two |= one & state.digits[d][b];
+                one |= state.digits[d][b];
+            }
+
+            // A cell without any candidate left
+            if((one | state.solved[b]) != allCells)
+                return false;
+
+            uint32_t singles = one & ~two & ~state.solved[b];
+            while(singles)
+            {
+                const int bit = lowestBitIndex(singles);
+                singles &= singles - 1;
+                for(int d = 0; d < 9; ++d)
+                {
+                    if(state.digits[d][b] & (1u << bit))
+                    {
+                        place(state, d, b, bit);
+                        break;
+                    }
+                }
+                changed = true;
+            }
+        }
+    }
+    return true;
+}
+
+// Branches on a bivalue cell if there is one, otherwise on the first open cell
+bool BandSolver::search(State& state, State& solution) const
+{
+    if(m_cancel != nullptr && m_cancel->load(std::memory_order_relaxed))
+        return false;
+
+    if(!propagate(state))
+        return false;
+
+    if(state.solved[0] == allCells && state.solved[1] == allCells && state.solved[2] == allCells)
+    {
+        solution = state;
+        return true;
+    }
+
+    int band = -1;
+    int bit = -1;
+    for(int b = 0; b < 3 && band < 0; ++b)
+    {
+        uint32_t one = 0;
+        uint32_t two = 0;
+        uint32_t three = 0;
+        for(int d = 0; d < 9; ++d)
+        {
+            three |= two & state.digits[d][b];
+            two |= one & state.digits[d][b];
+            one |= state.digits[d][b];
+        }
+        const uint32_t bivalue = two & ~three & ~state.solved[b];
+        if(bivalue)
+        {
+            band = b;
+            bit = lowestBitIndex(bivalue);
+        }
+    }
+    if(band < 0)
+    {
+        for(int b = 0; b < 3 && band < 0; ++b)
+        {
+            if(state.solved[b] != allCells)
+            {
+                band = b;
+                bit = lowestBitIndex(~state.solved[b] & allCells);
+            }
+        }
+    }
+
+    for(int d = 0; d < 9; ++d)
+    {
+        if(!(state.digits[d][band] & (1u << bit)))
+            continue;
+        State trial = state;
+        place(trial, d, band, bit);
+        if(search(trial, solution))
+            return true;
+    }
+    return false;
+}
+
+bool BandSolver::solve(std::vector<int>& puzzle) const
+{
+    if(puzzle.size() != 81)
+        return false;
+
+    State state;
+    for(int d = 0; d < 9; ++d)
+    {
+        for(int b = 0; b < 3; ++b)
+            state.digits[d][b] = allCells;
+    }
+    for(int b = 0; b < 3; ++b)
+        state.solved[b] = 0;
+
+    for(int cell = 0; cell < 81; ++cell)
+    {
+        const int digit = puzzle[cell];
+        if(digit == m_EMPTY)
+            continue;
+
+        const int band = cell / 27;
+        const int bit = cell % 27;
+
+        // The digit must still be possible (catches duplicate givens)
+        if(digit < 1 || digit > 9 || !(state.digits[digit - 1][band] & (1u << bit)))
+            return false;
+        place(state, digit - 1, band, bit);
+    }
+
+    State solution;
+    if(!search(state, solution))
+        return false;
+
+    for(int cell = 0; cell < 81; ++cell)
+    {
+        const uint32_t bit = 1u << (cell % 27);
+        for(int d = 0; d < 9; ++d)
+        {
+            if(solution.digits[d][cell / 27] & bit)
+            {
+                puzzle[cell] = d + 1;
+                break;
+            }
+        }
+    }
+    return true;
+}
+
+void BandSolver::setCancelFlag(const std::atomic<bool>* cancel)
+{
+    m_cancel = cancel;
+}
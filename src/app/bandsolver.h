@@ -0,0 +1,42 @@
+#ifndef BANDSOLVER_H
+#define BANDSOLVER_H
+
+#include <vector>
+#include <cstdint>
+#include <atomic>
+#include "bitutils.h"
+
+// Bit-parallel 9x9 solver working on bands (three rows of the grid) instead of single cells.
+// For every digit each band is packed into a 27 bit vector (bit = row_in_band * 9 + col), so
+// row, column, box and locked candidate eliminations are a few AND/OR operations per band.
+class BandSolver
+{
+private:
+    // Candidate bit vectors of the nine digits plus the already placed cells per band
+    struct State
+    {
+        uint32_t digits[9][3];
+        uint32_t solved[3];
+    };
+
+    // Member variables
+    const int m_EMPTY = 0;
+    const std::atomic<bool>* m_cancel;
+
+    /* ----------------------- Private member functions ----------------------- */
+    static void place(State& state, const int digit, const int band, const int bit);
+    static bool propagate(State& state);
+    bool search(State& state, State& solution) const;
+
+public:
+    BandSolver();   // Constructor
+    ~BandSolver();  // Destructor
+
+    /* ----------------------- Public member functions ----------------------- */
+    bool solve(std::vector<int>& puzzle) const;
+
+    // Abort a running search as soon as the flag becomes true (nullptr disables it)
+    void setCancelFlag(const std::atomic<bool>* cancel);
+};
+
+#endif // BANDSOLVER_H
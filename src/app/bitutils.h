@@ -0,0 +1,49 @@
+#ifndef BITUTILS_H
+#define BITUTILS_H
+
+#include <cstdint>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Small bit manipulation helpers shared by the mask based solvers and classifiers
+
+// Number of set bits in a 32 bit mask
+inline int popCount(const uint32_t x)
+{
+#if defined(_MSC_VER)
+    return static_cast<int>(__popcnt(x));
+#else
+    return __builtin_popcount(x);
+#endif
+}
+
+// Number of set bits in a 64 bit mask
+inline int popCount64(const uint64_t x)
+{
+#if defined(_MSC_VER)
+    return static_cast<int>(__popcnt64(x));
+#elif defined(__POPCNT__)
+    return __builtin_popcountll(x);
+#else
+    // Without the popcnt instruction the builtin is a library call, SWAR is faster
+    uint64_t v = x - ((x >> 1) & 0x5555555555555555ULL);
+    v = (v & 0x3333333333333333ULL) + ((v >> 2) & 0x3333333333333333ULL);
+    v = (v + (v >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+    return static_cast<int>((v * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+// Index of the lowest set bit (x must not be zero)
+inline int lowestBitIndex(const uint32_t x)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, x);
+    return static_cast<int>(index);
+#else
+    return __builtin_ctz(x);
+#endif
+}
+
+#endif // BITUTILS_H
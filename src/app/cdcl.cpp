@@ -0,0 +1,662 @@
+#include "cdcl.h"
+#include <algorithm>
+
+CDCLSolver::CDCLSolver(const int boxSize)
+    : m_boxSize(boxSize)
+    , m_N(boxSize * boxSize)
+    , m_cells(m_N * m_N)
+    , m_numVars(0)
+    , m_unsat(false)
+    , m_qhead(0)
+    , m_varInc(1.0)
+    , m_clauseInc(1.0)
+    , m_maxLearnts(0.0)
+    , m_conflicts(0)
+    , m_decisions(0)
+    , m_cancel(nullptr)
+{}
+
+CDCLSolver::~CDCLSolver(){}
+
+void CDCLSolver::reset(const int numVars)
+{
+    m_numVars = numVars;
+    m_unsat = false;
+    m_clauses.clear();
+    m_learnts.clear();
+    m_watches.assign(2 * numVars, std::vector<int>());
+    m_assigns.assign(numVars, 2);
+    m_level.assign(numVars, 0);
+    m_reason.assign(numVars, -1);
+    m_phase.assign(numVars, 0);
+    m_seen.assign(numVars, 0);
+    m_trail.clear();
+    m_trailLim.clear();
+    m_qhead = 0;
+    m_activity.assign(numVars, 0.0);
+    m_heap.clear();
+    m_heapIndex.assign(numVars, -1);
+    m_varInc = 1.0;
+    m_clauseInc = 1.0;
+    m_conflicts = 0;
+    m_decisions = 0;
+    for(int var = 0; var < numVars; ++var)
+        heapInsert(var);
+}
+
+// Adds an original clause at decision level 0 (false if the formula became unsatisfiable)
+bool CDCLSolver::addClause(std::vector<int> lits)
+{
+    if(m_unsat)
+        return false;
+
+    // Drop false literals, satisfied clauses are not needed at all
+    std::sort(lits.begin(), lits.end());
+    lits.erase(std::unique(lits.begin(), lits.end()), lits.end());
+    std::vector<int> kept;
+    for(const int lit : lits)
+    {
+        const int value = litValue(lit);
+        if(value == 1)
+            return true;
+        if(value == 2)
+            kept.push_back(lit);
+    }
+
+    if(kept.empty())
+    {
+        m_unsat = true;
+        return false;
+    }
+    if(kept.size() == 1)
+    {
+        enqueue(kept[0], -1);
+        if(propagate() >= 0)
+            m_unsat = true;
+        return !m_unsat;
+    }
+
+    Clause clause;
+    clause.lits = kept;
+    clause.activity = 0.0;
+    clause.lbd = 0;
+    clause.learnt = false;
+    clause.deleted = false;
+    m_clauses.push_back(clause);
+    const int cref = static_cast<int>(m_clauses.size()) - 1;
+    m_watches[kept[0]].push_back(cref);
+    m_watches[kept[1]].push_back(cref);
+    return true;
+}
+
+// 1 = true, 0 = false, 2 = unassigned
+int CDCLSolver::litValue(const int lit) const
+{
+    const int value = m_assigns[lit >> 1];
+    return (value == 2) ? 2 : (value ^ (lit & 1));
+}
+
+int CDCLSolver::decisionLevel() const
+{
+    return static_cast<int>(m_trailLim.size());
+}
+
+void CDCLSolver::enqueue(const int lit, const int reason)
+{
+    const int var = lit >> 1;
+    m_assigns[var] = static_cast<signed char>((lit & 1) ^ 1);
+    m_level[var] = decisionLevel();
+    m_reason[var] = reason;
+    m_trail.push_back(lit);
+}
+
+// Unit propagation with two watched literals, returns the conflicting clause or -1
+int CDCLSolver::propagate()
+{
+    while(m_qhead < m_trail.size())
+    {
+        const int falseLit = m_trail[m_qhead++] ^ 1;
+        std::vector<int>& watchers = m_watches[falseLit];
+
+        size_t i = 0;
+        size_t j = 0;
+        while(i < watchers.size())
+        {
+            const int cref = watchers[i++];
+            Clause& clause = m_clauses[cref];
+            if(clause.deleted)
+                continue;
+
+            // Make sure the false literal is the second watch
+            std::vector<int>& lits = clause.lits;
+            if(lits[0] == falseLit)
+                std::swap(lits[0], lits[1]);
+
+            // Clause already satisfied by the other watch
+            if(litValue(lits[0]) == 1)
+            {
+                watchers[j++] = cref;
+                continue;
+            }
+
+            // Look for a new literal to watch
+            bool moved = false;
+            for(size_t k = 2; k < lits.size(); ++k)
+            {
+                if(litValue(lits[k]) != 0)
+                {
+                    std::swap(lits[1], lits[k]);
+                    m_watches[lits[1]].push_back(cref);
+                    moved = true;
+                    break;
+                }
+            }
+            if(moved)
+                continue;
+
+            // Clause is unit or conflicting
+            watchers[j++] = cref;
+            if(litValue(lits[0]) == 0)
+            {
+                while(i < watchers.size())
+                    watchers[j++] = watchers[i++];
+                watchers.resize(j);
+                m_qhead = m_trail.size();
+                return cref;
+            }
+            enqueue(lits[0], cref);
+        }
+        watchers.resize(j);
+    }
+    return -1;
+}
+
+// First unique implication point analysis, learnt[0] is the asserting literal
+void CDCLSolver::analyze(int conflict, std::vector<int>& learnt, int& backtrackLevel, int& lbd)
+{
+    learnt.clear();
+    learnt.push_back(-1);
+    int pathCount = 0;
+    int lit = -1;
+    int index = static_cast<int>(m_trail.size()) - 1;
+
+    do
+    {
+        Clause& clause = m_clauses[conflict];
+        if(clause.learnt)
+            bumpClause(clause);
+
+        for(size_t k = (lit == -1) ? 0 : 1; k < clause.lits.size(); ++k)
+        {
+            const int q = clause.lits[k];
+            const int var = q >> 1;
+            if(!m_seen[var] && m_level[var] > 0)
+            {
+                bumpVar(var);
+                m_seen[var] = 1;
+                if(m_level[var] >= decisionLevel())
+                    ++pathCount;
+                else
+                    learnt.push_back(q);
+            }
+        }
+
+        // Next literal of the current level on the trail
+        while(!m_seen[m_trail[index] >> 1])
+            --index;
+        lit = m_trail[index];
+        --index;
+        conflict = m_reason[lit >> 1];
+        m_seen[lit >> 1] = 0;
+        --pathCount;
+    } while(pathCount > 0);
+    learnt[0] = lit ^ 1;
+
+    // Remove literals implied by the rest of the clause
+    std::vector<int> original(learnt);
+    size_t kept = 1;
+    for(size_t k = 1; k < learnt.size(); ++k)
+    {
+        if(!redundant(learnt[k]))
+            learnt[kept++] = learnt[k];
+    }
+    learnt.resize(kept);
+    for(const int q : original)
+        m_seen[q >> 1] = 0;
+
+    // Second watch is the literal with the highest level
+    backtrackLevel = 0;
+    if(learnt.size() > 1)
+    {
+        size_t maxIndex = 1;
+        for(size_t k = 2; k < learnt.size(); ++k)
+        {
+            if(m_level[learnt[k] >> 1] > m_level[learnt[maxIndex] >> 1])
+                maxIndex = k;
+        }
+        std::swap(learnt[1], learnt[maxIndex]);
+        backtrackLevel = m_level[learnt[1] >> 1];
+    }
+
+    // Literal block distance: number of distinct decision levels in the clause
+    std::vector<int> levels;
+    for(const int q : learnt)
+        levels.push_back(m_level[q >> 1]);
+    std::sort(levels.begin(), levels.end());
+    lbd = static_cast<int>(std::unique(levels.begin(), levels.end()) - levels.begin());
+}
+
+// A literal is redundant if all other literals of its reason are already in the clause
+bool CDCLSolver::redundant(const int lit) const
+{
+    const int reason = m_reason[lit >> 1];
+    if(reason < 0)
+        return false;
+
+    const std::vector<int>& lits = m_clauses[reason].lits;
+    for(size_t k = 1; k < lits.size(); ++k)
+    {
+        const int var = lits[k] >> 1;
+        if(!m_seen[var] && m_level[var] > 0)
+            return false;
+    }
+    return true;
+}
+
+void CDCLSolver::cancelUntil(const int level)
+{
+    if(decisionLevel() <= level)
+        return;
+
+    for(int k = static_cast<int>(m_trail.size()) - 1; k >= m_trailLim[level]; --k)
+    {
+        const int var = m_trail[k] >> 1;
+        m_phase[var] = static_cast<char>(m_assigns[var]);
+        m_assigns[var] = 2;
+        m_reason[var] = -1;
+        heapInsert(var);
+    }
+    m_trail.resize(m_trailLim[level]);
+    m_trailLim.resize(level);
+    m_qhead = m_trail.size();
+}
+
+// Deletes the less useful half of the learnt clauses (high LBD, low activity)
+void CDCLSolver::reduceLearnts()
+{
+    std::sort(m_learnts.begin(), m_learnts.end(), [this](int a, int b)
+    {
+        const Clause& ca = m_clauses[a];
+        const Clause& cb = m_clauses[b];
+        if(ca.lbd != cb.lbd)
+            return ca.lbd > cb.lbd;
+        return ca.activity < cb.activity;
+    });
+
+    const size_t half = m_learnts.size() / 2;
+    std::vector<int> kept;
+    for(size_t k = 0; k < m_learnts.size(); ++k)
+    {
+        const int cref = m_learnts[k];
+        Clause& clause = m_clauses[cref];
+
+        // Clauses that are the reason of an assignment are locked
+        const int first = clause.lits[0];
+        const bool locked = litValue(first) == 1 && m_reason[first >> 1] == cref;
+
+        if(k < half && !locked && clause.lbd > 2 && clause.lits.size() > 2)
+        {
+            clause.deleted = true;
+            std::vector<int>().swap(clause.lits);
+        }
+        else
+            kept.push_back(cref);
+    }
+    m_learnts.swap(kept);
+}
+
+int CDCLSolver::pickBranchLit()
+{
+    while(!m_heap.empty())
+    {
+        const int var = heapPop();
+        if(m_assigns[var] == 2)
+            return 2 * var + (m_phase[var] ? 0 : 1);
+    }
+    return -1;
+}
+
+// CDCL loop until a solution, a refutation or the conflict budget (restart) is reached
+bool CDCLSolver::search(const long conflictBudget, bool& done)
+{
+    long conflicts = 0;
+    std::vector<int> learnt;
+
+    while(true)
+    {
+        const int conflict = propagate();
+        if(conflict >= 0)
+        {
+            ++m_conflicts;
+            ++conflicts;
+            if(decisionLevel() == 0)
+            {
+                done = true;
+                return false;
+            }
+
+            int backtrackLevel = 0;
+            int lbd = 0;
+            analyze(conflict, learnt, backtrackLevel, lbd);
+            cancelUntil(backtrackLevel);
+
+            if(learnt.size() == 1)
+                enqueue(learnt[0], -1);
+            else
+            {
+                Clause clause;
+                clause.lits = learnt;
+                clause.activity = 0.0;
+                clause.lbd = lbd;
+                clause.learnt = true;
+                clause.deleted = false;
+                m_clauses.push_back(clause);
+                const int cref = static_cast<int>(m_clauses.size()) - 1;
+                m_learnts.push_back(cref);
+                m_watches[learnt[0]].push_back(cref);
+                m_watches[learnt[1]].push_back(cref);
+                bumpClause(m_clauses[cref]);
+                enqueue(learnt[0], cref);
+            }
+
+            m_varInc /= m_varDecay;
+            m_clauseInc /= m_clauseDecay;
+        }
+        else
+        {
+            if(m_cancel != nullptr && m_cancel->load(std::memory_order_relaxed))
+            {
+                done = true;
+                return false;
+            }
+
+            // Restart: keep the learnt clauses but drop all decisions
+            if(conflicts >= conflictBudget)
+            {
+                cancelUntil(0);
+                return false;
+            }
+
+            if(static_cast<double>(m_learnts.size()) - m_trail.size() >= m_maxLearnts)
+            {
+                reduceLearnts();
+                m_maxLearnts *= 1.1;
+            }
+
+            const int lit = pickBranchLit();
+            if(lit < 0)
+            {
+                done = true;
+                return true;
+            }
+
+            ++m_decisions;
+            m_trailLim.push_back(static_cast<int>(m_trail.size()));
+            enqueue(lit, -1);
+        }
+    }
+}
+
+bool CDCLSolver::solveInstance()
+{
+    if(m_unsat)
+        return false;
+
+    m_maxLearnts = std::max(1000.0, m_clauses.size() / 3.0);
+    for(int restart = 0; ; ++restart)
+    {
+        bool done = false;
+        const long budget = static_cast<long>(luby(restart) * m_restartBase);
+        const bool satisfied = search(budget, done);
+        if(done)
+            return satisfied;
+    }
+}
+
+void CDCLSolver::bumpVar(const int var)
+{
+    m_activity[var] += m_varInc;
+
+    // Rescale to avoid overflow
+    if(m_activity[var] > 1e100)
+    {
+        for(double& activity : m_activity)
+            activity *= 1e-100;
+        m_varInc *= 1e-100;
+    }
+    if(m_heapIndex[var] >= 0)
+        heapUp(m_heapIndex[var]);
+}
+
+void CDCLSolver::bumpClause(Clause& clause)
+{
+    clause.activity += m_clauseInc;
+    if(clause.activity > 1e20)
+    {
+        for(const int cref : m_learnts)
+            m_clauses[cref].activity *= 1e-20;
+        m_clauseInc *= 1e-20;
+    }
+}
+
+void CDCLSolver::heapInsert(const int var)
+{
+    if(m_heapIndex[var] >= 0)
+        return;
+    m_heapIndex[var] = static_cast<int>(m_heap.size());
+    m_heap.push_back(var);
+    heapUp(m_heapIndex[var]);
+}
+
+void CDCLSolver::heapUp(int pos)
+{
+    const int var = m_heap[pos];
+    while(pos > 0)
+    {
+        const int parent = (pos - 1) / 2;
+        if(m_activity[m_heap[parent]] >= m_activity[var])
+            break;
+        m_heap[pos] = m_heap[parent];
+        m_heapIndex[m_heap[pos]] = pos;
+        pos = parent;
+    }
+    m_heap[pos] = var;
+    m_heapIndex[var] = pos;
+}
+
+void CDCLSolver::heapDown(int pos)
+{
+    const int var = m_heap[pos];
+    const int size = static_cast<int>(m_heap.size());
+    while(2 * pos + 1 < size)
+    {
+        int child = 2 * pos + 1;
+        if(child + 1 < size && m_activity[m_heap[child + 1]] > m_activity[m_heap[child]])
+            ++child;
+        if(m_activity[m_heap[child]] <= m_activity[var])
+            break;
+        m_heap[pos] = m_heap[child];
+        m_heapIndex[m_heap[pos]] = pos;
+        pos = child;
+    }
+    m_heap[pos] = var;
+    m_heapIndex[var] = pos;
+}
+
+int CDCLSolver::heapPop()
+{
+    const int top = m_heap[0];
+    m_heapIndex[top] = -1;
+    const int last = m_heap.back();
+    m_heap.pop_back();
+    if(!m_heap.empty())
+    {
+        m_heap[0] = last;
+        m_heapIndex[last] = 0;
+        heapDown(0);
+    }
+    return top;
+}
+
+// Luby restart sequence: 1 1 2 1 1 2 4 1 1 2 ...
+double CDCLSolver::luby(int x)
+{
+    int size = 1;
+    int seq = 0;
+    while(size < x + 1)
+    {
+        ++seq;
+        size = 2 * size + 1;
+    }
+    while(size - 1 != x)
+    {
+        size = (size - 1) / 2;
+        --seq;
+        x = x % size;
+    }
+    double value = 1.0;
+    for(int k = 0; k < seq; ++k)
+        value *= 2.0;
+    return value;
+}
+
+// Encodes the open part of the sudoku (givens are not turned into variables) and solves it
+bool CDCLSolver::solve(std::vector<int>& puzzle)
+{
+    if(static_cast<int>(puzzle.size()) != m_cells)
+        return false;
+
+    // Units: rows, columns and boxes
+    std::vector<std::vector<int>> units(3 * m_N);
+    for(int row = 0; row < m_N; ++row)
+    {
+        for(int col = 0; col < m_N; ++col)
+        {
+            const int cell = row * m_N + col;
+            units[row].push_back(cell);
+            units[m_N + col].push_back(cell);
+            units[2 * m_N + (row / m_boxSize) * m_boxSize + col / m_boxSize].push_back(cell);
+        }
+    }
+
+    // Remove the digits of the givens from their units, duplicates make the puzzle unsolvable
+    std::vector<char> allowed(m_cells * m_N, 1);
+    std::vector<char> placed(3 * m_N * m_N, 0);
+    for(int u = 0; u < 3 * m_N; ++u)
+    {
+        for(const int cell : units[u])
+        {
+            const int digit = puzzle[cell];
+            if(digit == m_EMPTY)
+                continue;
+            if(digit < 0 || digit > m_N || placed[u * m_N + digit - 1])
+                return false;
+            placed[u * m_N + digit - 1] = 1;
+        }
+        for(int d = 0; d < m_N; ++d)
+        {
+            if(!placed[u * m_N + d])
+                continue;
+            for(const int cell : units[u])
+                allowed[cell * m_N + d] = 0;
+        }
+    }
+
+    // One variable for every open (cell, digit) pair that is still allowed
+    std::vector<int> varOf(m_cells * m_N, -1);
+    std::vector<int> cellOf;
+    std::vector<int> digitOf;
+    for(int cell = 0; cell < m_cells; ++cell)
+    {
+        if(puzzle[cell] != m_EMPTY)
+            continue;
+        for(int d = 0; d < m_N; ++d)
+        {
+            if(allowed[cell * m_N + d])
+            {
+                varOf[cell * m_N + d] = static_cast<int>(cellOf.size());
+                cellOf.push_back(cell);
+                digitOf.push_back(d + 1);
+            }
+        }
+    }
+    reset(static_cast<int>(cellOf.size()));
+
+    // Exactly one of the literals is true (at-least-one clause plus pairwise at-most-one)
+    auto exactlyOne = [this](const std::vector<int>& vars)
+    {
+        std::vector<int> atLeastOne;
+        for(const int var : vars)
+            atLeastOne.push_back(2 * var);
+        addClause(atLeastOne);
+        for(size_t a = 0; a < vars.size(); ++a)
+        {
+            for(size_t b = a + 1; b < vars.size(); ++b)
+                addClause({2 * vars[a] + 1, 2 * vars[b] + 1});
+        }
+    };
+
+    std::vector<int> vars;
+    for(int cell = 0; cell < m_cells; ++cell)
+    {
+        if(puzzle[cell] != m_EMPTY)
+            continue;
+        vars.clear();
+        for(int d = 0; d < m_N; ++d)
+        {
+            if(varOf[cell * m_N + d] >= 0)
+                vars.push_back(varOf[cell * m_N + d]);
+        }
+        exactlyOne(vars);
+    }
+    for(int u = 0; u < 3 * m_N; ++u)
+    {
+        for(int d = 0; d < m_N; ++d)
+        {
+            if(placed[u * m_N + d])
+                continue;
+            vars.clear();
+            for(const int cell : units[u])
+            {
+                if(varOf[cell * m_N + d] >= 0)
+                    vars.push_back(varOf[cell * m_N + d]);
+            }
+            exactlyOne(vars);
+        }
+    }
+
+    if(!solveInstance())
+        return false;
+
+    for(int var = 0; var < m_numVars; ++var)
+    {
+        if(m_assigns[var] == 1)
+            puzzle[cellOf[var]] = digitOf[var];
+    }
+    return true;
+}
+
+void CDCLSolver::setCancelFlag(const std::atomic<bool>* cancel)
+{
+    m_cancel = cancel;
+}
+
+long CDCLSolver::conflicts() const
+{
+    return m_conflicts;
+}
+
+long CDCLSolver::decisions() const
+{
+    return m_decisions;
+}
@@ -0,0 +1,98 @@
+#ifndef CDCL_H
+#define CDCL_H
+
+#include <vector>
+#include <atomic>
+#include <cstddef>
+
+// Conflict-driven clause-learning SAT solver with a native sudoku encoding.
+// Meant for large grids (16x16, 25x25, ...) where plain backtracking gets stuck.
+// Features: two watched literals, 1UIP learning with clause minimization, VSIDS
+// branching with phase saving, Luby restarts and LBD based clause-database reduction.
+class CDCLSolver
+{
+private:
+    struct Clause
+    {
+        std::vector<int> lits;
+        double activity;
+        int lbd;
+        bool learnt;
+        bool deleted;
+    };
+
+    // Member variables
+    const int m_boxSize;
+    const int m_N;
+    const int m_cells;
+    const int m_EMPTY = 0;
+    const int m_restartBase = 100;    // Conflicts per Luby unit
+    const double m_varDecay = 0.95;
+    const double m_clauseDecay = 0.999;
+
+    // Literals are encoded as 2*var (positive) and 2*var+1 (negative)
+    int m_numVars;
+    bool m_unsat;
+    std::vector<Clause> m_clauses;
+    std::vector<int> m_learnts;                 // Indices of learnt clauses
+    std::vector<std::vector<int>> m_watches;    // Clauses watching a literal
+    std::vector<signed char> m_assigns;         // 0 = false, 1 = true, 2 = unassigned
+    std::vector<int> m_level;
+    std::vector<int> m_reason;
+    std::vector<char> m_phase;
+    std::vector<char> m_seen;
+    std::vector<int> m_trail;
+    std::vector<int> m_trailLim;
+    size_t m_qhead;
+
+    // VSIDS heap ordered by variable activity
+    std::vector<double> m_activity;
+    std::vector<int> m_heap;
+    std::vector<int> m_heapIndex;
+    double m_varInc;
+    double m_clauseInc;
+    double m_maxLearnts;
+
+    long m_conflicts;
+    long m_decisions;
+    const std::atomic<bool>* m_cancel;
+
+    /* ----------------------- Private member functions ----------------------- */
+    void reset(const int numVars);
+    bool addClause(std::vector<int> lits);
+    int litValue(const int lit) const;
+    int decisionLevel() const;
+    void enqueue(const int lit, const int reason);
+    int propagate();
+    void analyze(int conflict, std::vector<int>& learnt, int& backtrackLevel, int& lbd);
+    bool redundant(const int lit) const;
+    void cancelUntil(const int level);
+    void reduceLearnts();
+    int pickBranchLit();
+    bool search(const long conflictBudget, bool& done);
+    bool solveInstance();
+
+    void bumpVar(const int var);
+    void bumpClause(Clause& clause);
+    void heapInsert(const int var);
+    void heapUp(int pos);
+    void heapDown(int pos);
+    int heapPop();
+
+    static double luby(int x);
+
+public:
+    explicit CDCLSolver(const int boxSize = 3);  // Constructor
+    ~CDCLSolver();                               // Destructor
+
+    /* ----------------------- Public member functions ----------------------- */
+    bool solve(std::vector<int>& puzzle);
+
+    // Abort a running search as soon as the flag becomes true (nullptr disables it)
+    void setCancelFlag(const std::atomic<bool>* cancel);
+
+    long conflicts() const;
+    long decisions() const;
+};
+
+#endif // CDCL_H
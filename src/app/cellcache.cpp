@@ -0,0 +1,122 @@
+#include "cellcache.h"
+#include <cstring>
+
+namespace
+{
+// Label, runner-up and the bits of the confidence in one word, so a slot has no torn predictions
+uint64_t packPrediction(const CellPrediction& prediction)
+{
+    uint32_t confidence;
+    std::memcpy(&confidence, &prediction.confidence, sizeof(confidence));
+    return static_cast<uint64_t>(static_cast<uint8_t>(prediction.label)) |
+           static_cast<uint64_t>(static_cast<uint8_t>(prediction.runnerUp)) << 8 |
+           static_cast<uint64_t>(confidence) << 32;
+}
+
+CellPrediction unpackPrediction(const uint64_t packed)
+{
+    CellPrediction prediction;
+    prediction.label = static_cast<char>(packed & 0xFF);
+    prediction.runnerUp = static_cast<char>((packed >> 8) & 0xFF);
+    const uint32_t confidence = static_cast<uint32_t>(packed >> 32);
+    std::memcpy(&prediction.confidence, &confidence, sizeof(confidence));
+    return prediction;
+}
+}
+
+double CellCache::Statistics::hitRate() const
+{
+    const uint64_t lookups = hits + misses;
+    return (lookups > 0) ? static_cast<double>(hits) / lookups : 0.0;
+}
+
+CellCache::CellCache(const int cellLength, const int slotCount)
+    : m_cellLength(cellLength)
+    , m_keyWords((cellLength + 7) / 8)
+    , m_slotWords(m_keyWords + 3)
+    , m_hits(0)
+    , m_misses(0)
+{
+    int slots = 1;
+    while(slots < slotCount)
+        slots *= 2;
+    m_slotMask = slots - 1;
+
+    // Sequence 0 marks a slot that was never written
+    const size_t words = static_cast<size_t>(slots) * m_slotWords;
+    m_slots.reset(new std::atomic<uint64_t>[words]);
+    for(size_t i = 0; i < words; ++i)
+        m_slots[i].store(0, std::memory_order_relaxed);
+}
+
+CellCache::~CellCache(){}
+
+// Multiply-xorshift over the key words
+uint64_t CellCache::hash(const uint64_t* key, const int words)
+{
+    uint64_t h = 0x243F6A8885A308D3ULL;
+    for(int i = 0; i < words; ++i)
+    {
+        h = (h ^ key[i]) * 0x9E3779B97F4A7C15ULL;
+        h ^= h >> 32;
+    }
+    return h;
+}
+
+int CellCache::keyWords() const
+{
+    return m_keyWords;
+}
+
+void CellCache::pack(const uint8_t* cell, uint64_t* key) const
+{
+    // The last word is padded with zeros
+    key[m_keyWords - 1] = 0;
+    std::memcpy(key, cell, m_cellLength);
+}
+
+bool CellCache::lookup(const uint64_t* key, CellPrediction& prediction)
+{
+    const uint64_t keyHash = hash(key, m_keyWords);
+    const std::atomic<uint64_t>* slot = &m_slots[static_cast<size_t>(keyHash & m_slotMask) * m_slotWords];
+
+    // Seqlock read: the slot is only valid if its (even, non zero) sequence did not change meanwhile
+    const uint64_t sequence = slot[0].load(std::memory_order_acquire);
+    bool match = sequence != 0 && (sequence & 1) == 0 && slot[1].load(std::memory_order_relaxed) == keyHash;
+    for(int w = 0; match && w < m_keyWords; ++w)
+        match = slot[2 + w].load(std::memory_order_relaxed) == key[w];
+    const uint64_t packed = slot[2 + m_keyWords].load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    if(!match || slot[0].load(std::memory_order_relaxed) != sequence)
+    {
+        m_misses.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    prediction = unpackPrediction(packed);
+    m_hits.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void CellCache::insert(const uint64_t* key, const CellPrediction& prediction)
+{
+    const uint64_t keyHash = hash(key, m_keyWords);
+    std::atomic<uint64_t>* slot = &m_slots[static_cast<size_t>(keyHash & m_slotMask) * m_slotWords];
+
+    // An odd sequence belongs to another writer, then this insert is dropped (never waits)
+    uint64_t sequence = slot[0].load(std::memory_order_relaxed);
+    if((sequence & 1) != 0 || !slot[0].compare_exchange_strong(sequence, sequence + 1, std::memory_order_acquire))
+        return;
+    std::atomic_thread_fence(std::memory_order_release);
+
+    slot[1].store(keyHash, std::memory_order_relaxed);
+    for(int w = 0; w < m_keyWords; ++w)
+        slot[2 + w].store(key[w], std::memory_order_relaxed);
+    slot[2 + m_keyWords].store(packPrediction(prediction), std::memory_order_relaxed);
+    slot[0].store(sequence + 2, std::memory_order_release);
+}
+
+CellCache::Statistics CellCache::statistics() const
+{
+    return Statistics{m_hits.load(std::memory_order_relaxed), m_misses.load(std::memory_order_relaxed)};
+}
@@ -0,0 +1,59 @@
+#ifndef CELLCACHE_H
+#define CELLCACHE_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include "digitclassifier.h"
+
+// Exact-match cache of cell classifications. The key is the whole cell packed into 64 bit words
+// (the resized cells keep grey values at the digit edges, so every byte counts): a cell that was
+// classified before is answered without running the classifier, e.g. the same frame analysed
+// again or sheets that repeat a digit image. Only identical cells hit, the labels stay exact.
+//
+// Direct mapped and lock free: every slot is guarded by a sequence number (seqlock). A writer
+// makes it odd while it stores the slot, readers retry nothing and count a miss if the number
+// was odd or changed during their read. Concurrent writers to one slot skip their insert.
+class CellCache
+{
+public:
+    struct Statistics
+    {
+        uint64_t hits;
+        uint64_t misses;
+        double hitRate() const;     // hits / (hits + misses)
+    };
+
+private:
+    // Member variables
+    int m_cellLength;                               // Pixels per cell
+    int m_keyWords;                                 // uint64 words per packed cell (8 pixels each)
+    int m_slotWords;                                // sequence, hash, key, prediction
+    int m_slotMask;                                 // Slot count - 1 (power of two)
+    std::unique_ptr<std::atomic<uint64_t>[]> m_slots;
+    std::atomic<uint64_t> m_hits;
+    std::atomic<uint64_t> m_misses;
+
+    /* ----------------------- Private member functions ----------------------- */
+    static uint64_t hash(const uint64_t* key, const int words);
+
+public:
+    CellCache(const int cellLength = 600, const int slotCount = 512);    // Constructor
+    ~CellCache();                                                       // Destructor
+    CellCache(const CellCache&) = delete;
+    CellCache& operator=(const CellCache&) = delete;
+
+    /* ----------------------- Public member functions ----------------------- */
+    int keyWords() const;
+
+    // Pack a cell (cellLength bytes) into key (keyWords() words)
+    void pack(const uint8_t* cell, uint64_t* key) const;
+
+    // Classification stored for exactly this key
+    bool lookup(const uint64_t* key, CellPrediction& prediction);
+    void insert(const uint64_t* key, const CellPrediction& prediction);
+
+    Statistics statistics() const;
+};
+
+#endif // CELLCACHE_H
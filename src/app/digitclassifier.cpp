@@ -0,0 +1,66 @@
+#include "digitclassifier.h"
+#include "nearestneighbour.h"
+#include "hammingclassifier.h"
+#include "templateclassifier.h"
+#include "mlpclassifier.h"
+
+DigitClassifier::~DigitClassifier(){}
+
+bool DigitClassifier::load(const ModelFile&)
+{
+    return false;
+}
+
+ModelPayloads DigitClassifier::parameters() const
+{
+    return ModelPayloads();
+}
+
+float DigitClassifier::distanceConfidence(const float best, const float runnerUp, const bool hasRunnerUp)
+{
+    if(!hasRunnerUp)
+        return 1.0f;
+    return (runnerUp > 0.0f) ? 1.0f - best / runnerUp : 0.0f;
+}
+
+std::map<std::string, ClassifierRegistry::Entry>& ClassifierRegistry::factories()
+{
+    static std::map<std::string, Entry> registered =
+    {
+        {"knn", {[]() { return std::unique_ptr<DigitClassifier>(new NearestNeighbour()); }, true}},
+        {"hamming", {[]() { return std::unique_ptr<DigitClassifier>(new HammingClassifier()); }, false}},
+        {"template", {[]() { return std::unique_ptr<DigitClassifier>(new TemplateClassifier()); }, true}},
+        {"mlp", {[]() { return std::unique_ptr<DigitClassifier>(new MlpClassifier()); }, true}}
+    };
+    return registered;
+}
+
+bool ClassifierRegistry::add(const std::string& name, const Factory& factory, const bool acceptsProjectedFeatures)
+{
+    if(name.empty() || !factory)
+        return false;
+    const Entry entry = {factory, acceptsProjectedFeatures};
+    return factories().insert(std::make_pair(name, entry)).second;
+}
+
+std::unique_ptr<DigitClassifier> ClassifierRegistry::create(const std::string& name)
+{
+    const auto entry = factories().find(name);
+    if(entry == factories().end())
+        return std::unique_ptr<DigitClassifier>();
+    return entry->second.factory();
+}
+
+bool ClassifierRegistry::acceptsProjectedFeatures(const std::string& name)
+{
+    const auto entry = factories().find(name);
+    return entry != factories().end() && entry->second.acceptsProjectedFeatures;
+}
+
+std::vector<std::string> ClassifierRegistry::names()
+{
+    std::vector<std::string> result;
+    for(const auto& entry : factories())
+        result.push_back(entry.first);
+    return result;
+}
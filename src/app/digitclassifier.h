@@ -0,0 +1,82 @@
+#ifndef DIGITCLASSIFIER_H
+#define DIGITCLASSIFIER_H
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <opencv2/core.hpp>
+#include "modelfile.h"
+
+// Classification of one cell: best label, the best label of any other digit and how clearly
+// the best one wins (0: the runner-up is as near as the best match, 1: no other digit at all)
+struct CellPrediction
+{
+    char label;
+    char runnerUp;
+    float confidence;
+};
+
+// Interface of the OCR digit classifiers. All backends take the same batch layout:
+// one sample per row, CV_8U features (the cell pixels or the projected features of
+// OCR::makeBatch, see ClassifierRegistry), labels as ASCII codes (CV_32S, one per row).
+class DigitClassifier
+{
+protected:
+    /* ----------------------- Protected member functions ----------------------- */
+    // 1 - best / runner-up distance (0 if both are equal, 1 without runner-up)
+    static float distanceConfidence(const float best, const float runnerUp, const bool hasRunnerUp);
+
+public:
+    virtual ~DigitClassifier();
+
+    /* ----------------------- Public member functions ----------------------- */
+    virtual bool train(const cv::Mat& samples, const cv::Mat& labels) = 0;
+    virtual bool empty() const = 0;
+    virtual int dims() const = 0;
+
+    // Classify all rows of samples (dims() bytes each) in one call
+    virtual std::vector<CellPrediction> classify(const cv::Mat& samples) const = 0;
+
+    // Backends that are trained offline store their parameters as extra model sections.
+    // load returns false if the model has none for this backend (then train on the samples).
+    virtual bool load(const ModelFile& model);
+    virtual ModelPayloads parameters() const;
+};
+
+// Name --> factory of the available classifiers, so the backend can be chosen from configuration.
+// Built in: "knn" (NearestNeighbour), "hamming" (HammingClassifier), "template" (TemplateClassifier),
+// "mlp" (MlpClassifier).
+// Backends that binarise the pixels (hamming) are registered as not accepting projected features:
+// the quantised projections of a FeatureProjection model have no meaningful pixel threshold.
+// Additional backends have to be added before any classifier is created (not thread safe).
+class ClassifierRegistry
+{
+public:
+    typedef std::function<std::unique_ptr<DigitClassifier>()> Factory;
+
+private:
+    struct Entry
+    {
+        Factory factory;
+        bool acceptsProjectedFeatures;
+    };
+
+    /* ----------------------- Private member functions ----------------------- */
+    static std::map<std::string, Entry>& factories();
+
+public:
+    /* ----------------------- Public member functions ----------------------- */
+    static bool add(const std::string& name, const Factory& factory, const bool acceptsProjectedFeatures = true);
+
+    // Untrained classifier of the given name (nullptr if unknown)
+    static std::unique_ptr<DigitClassifier> create(const std::string& name);
+
+    // False if the backend only works on raw cell pixels (or is unknown)
+    static bool acceptsProjectedFeatures(const std::string& name);
+
+    static std::vector<std::string> names();
+};
+
+#endif // DIGITCLASSIFIER_H
@@ -0,0 +1,186 @@
+#include "dlx.h"
+
+DancingLinks::DancingLinks(const int boxSize)
+    : m_boxSize(boxSize)
+    , m_N(boxSize * boxSize)
+    , m_cells(m_N * m_N)
+    , m_columns(4 * m_N * m_N)
+    , m_cancel(nullptr)
+{}
+
+DancingLinks::~DancingLinks(){}
+
+// Creates the full exact cover matrix (one row for every cell and digit)
+void DancingLinks::build()
+{
+    const int rows = m_cells * m_N;
+    const int nodes = 1 + m_columns + 4 * rows;
+
+    m_left.assign(nodes, 0);
+    m_right.assign(nodes, 0);
+    m_up.assign(nodes, 0);
+    m_down.assign(nodes, 0);
+    m_column.assign(nodes, 0);
+    m_rowId.assign(nodes, -1);
+    m_rowStart.assign(rows, 0);
+    m_size.assign(m_columns + 1, 0);
+    m_chosen.clear();
+
+    // Root and column headers form a circular list
+    for(int col = 0; col <= m_columns; ++col)
+    {
+        m_left[col] = (col == 0) ? m_columns : col - 1;
+        m_right[col] = (col == m_columns) ? 0 : col + 1;
+        m_up[col] = col;
+        m_down[col] = col;
+        m_column[col] = col;
+    }
+
+    int node = m_columns + 1;
+    for(int cell = 0; cell < m_cells; ++cell)
+    {
+        const int row = cell / m_N;
+        const int col = cell % m_N;
+        const int box = (row / m_boxSize) * m_boxSize + col / m_boxSize;
+
+        for(int d = 0; d < m_N; ++d)
+        {
+            const int rowId = cell * m_N + d;
+            const int constraints[4] = {
+                1 + cell,
+                1 + m_cells + row * m_N + d,
+                1 + 2 * m_cells + col * m_N + d,
+                1 + 3 * m_cells + box * m_N + d
+            };
+
+            m_rowStart[rowId] = node;
+            for(int i = 0; i < 4; ++i)
+            {
+                const int header = constraints[i];
+
+                // Append the node at the bottom of its column
+                m_column[node] = header;
+                m_rowId[node] = rowId;
+                m_up[node] = m_up[header];
+                m_down[node] = header;
+                m_down[m_up[header]] = node;
+                m_up[header] = node;
+                ++m_size[header];
+
+                // Link the four nodes of the row horizontally
+                m_left[node] = (i == 0) ? node + 3 : node - 1;
+                m_right[node] = (i == 3) ? node - 3 : node + 1;
+                ++node;
+            }
+        }
+    }
+}
+
+void DancingLinks::cover(const int col)
+{
+    m_right[m_left[col]] = m_right[col];
+    m_left[m_right[col]] = m_left[col];
+    for(int i = m_down[col]; i != col; i = m_down[i])
+    {
+        for(int j = m_right[i]; j != i; j = m_right[j])
+        {
+            m_down[m_up[j]] = m_down[j];
+            m_up[m_down[j]] = m_up[j];
+            --m_size[m_column[j]];
+        }
+    }
+}
+
+void DancingLinks::uncover(const int col)
+{
+    for(int i = m_up[col]; i != col; i = m_up[i])
+    {
+        for(int j = m_left[i]; j != i; j = m_left[j])
+        {
+            ++m_size[m_column[j]];
+            m_down[m_up[j]] = j;
+            m_up[m_down[j]] = j;
+        }
+    }
+    m_right[m_left[col]] = col;
+    m_left[m_right[col]] = col;
+}
+
+bool DancingLinks::search()
+{
+    // All constraints covered --> solved
+    if(m_right[0] == 0)
+        return true;
+
+    if(m_cancel != nullptr && m_cancel->load(std::memory_order_relaxed))
+        return false;
+
+    // Choose the column with the fewest remaining rows
+    int col = m_right[0];
+    for(int c = m_right[col]; c != 0; c = m_right[c])
+    {
+        if(m_size[c] < m_size[col])
+            col = c;
+    }
+    if(m_size[col] == 0)
+        return false;
+
+    cover(col);
+    for(int r = m_down[col]; r != col; r = m_down[r])
+    {
+        m_chosen.push_back(m_rowId[r]);
+        for(int j = m_right[r]; j != r; j = m_right[j])
+            cover(m_column[j]);
+
+        if(search())
+            return true;
+
+        for(int j = m_left[r]; j != r; j = m_left[j])
+            uncover(m_column[j]);
+        m_chosen.pop_back();
+    }
+    uncover(col);
+    return false;
+}
+
+bool DancingLinks::solve(std::vector<int>& puzzle)
+{
+    if(static_cast<int>(puzzle.size()) != m_cells)
+        return false;
+
+    build();
+
+    // Select the rows of the givens up front, a given that hits a covered column is a conflict
+    std::vector<bool> covered(m_columns + 1, false);
+    for(int cell = 0; cell < m_cells; ++cell)
+    {
+        const int digit = puzzle[cell];
+        if(digit == m_EMPTY)
+            continue;
+        if(digit < 0 || digit > m_N)
+            return false;
+
+        const int start = m_rowStart[cell * m_N + digit - 1];
+        int node = start;
+        do
+        {
+            if(covered[m_column[node]])
+                return false;
+            covered[m_column[node]] = true;
+            cover(m_column[node]);
+            node = m_right[node];
+        } while(node != start);
+    }
+
+    if(!search())
+        return false;
+
+    for(const int rowId : m_chosen)
+        puzzle[rowId / m_N] = rowId % m_N + 1;
+    return true;
+}
+
+void DancingLinks::setCancelFlag(const std::atomic<bool>* cancel)
+{
+    m_cancel = cancel;
+}
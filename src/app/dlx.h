@@ -0,0 +1,48 @@
+#ifndef DLX_H
+#define DLX_H
+
+#include <vector>
+#include <atomic>
+
+// Knuth's Algorithm X with dancing links on the exact cover formulation of the sudoku.
+// Every (cell, digit) choice covers four constraints: cell, row-digit, column-digit, box-digit.
+class DancingLinks
+{
+private:
+    // Member variables
+    const int m_boxSize;
+    const int m_N;
+    const int m_cells;
+    const int m_columns;
+    const int m_EMPTY = 0;
+
+    // Node links (node 0 is the root, nodes 1..m_columns are the column headers)
+    std::vector<int> m_left;
+    std::vector<int> m_right;
+    std::vector<int> m_up;
+    std::vector<int> m_down;
+    std::vector<int> m_column;
+    std::vector<int> m_rowId;
+    std::vector<int> m_rowStart;    // First node of every (cell, digit) row
+    std::vector<int> m_size;        // Number of nodes per column
+    std::vector<int> m_chosen;      // Row ids of the partial solution
+    const std::atomic<bool>* m_cancel;
+
+    /* ----------------------- Private member functions ----------------------- */
+    void build();
+    void cover(const int col);
+    void uncover(const int col);
+    bool search();
+
+public:
+    explicit DancingLinks(const int boxSize = 3);  // Constructor
+    ~DancingLinks();                               // Destructor
+
+    /* ----------------------- Public member functions ----------------------- */
+    bool solve(std::vector<int>& puzzle);
+
+    // Abort a running search as soon as the flag becomes true (nullptr disables it)
+    void setCancelFlag(const std::atomic<bool>* cancel);
+};
+
+#endif // DLX_H
@@ -0,0 +1,156 @@
+#include "featureprojection.h"
+#include <algorithm>
+#include <cmath>
+
+const int FeatureProjection::m_factor;
+
+FeatureProjection::FeatureProjection()
+    : m_cellWidth(0)
+    , m_cellHeight(0)
+    , m_inputLength(0)
+    , m_components(0)
+{}
+
+FeatureProjection::~FeatureProjection(){}
+
+// Average of every m_factor x m_factor block of the cell
+void FeatureProjection::downsample(const uint8_t* cell, float* output) const
+{
+    const int width = m_cellWidth / m_factor;
+    const int height = m_cellHeight / m_factor;
+    const float norm = 1.0f / (m_factor * m_factor);
+
+    for(int y = 0; y < height; ++y)
+    {
+        for(int x = 0; x < width; ++x)
+        {
+            int sum = 0;
+            for(int dy = 0; dy < m_factor; ++dy)
+                for(int dx = 0; dx < m_factor; ++dx)
+                    sum += cell[(y * m_factor + dy) * m_cellWidth + x * m_factor + dx];
+            output[y * width + x] = sum * norm;
+        }
+    }
+}
+
+bool FeatureProjection::fit(const cv::Mat& samples, const int cellWidth, const int cellHeight, const int components)
+{
+    clear();
+    if(samples.empty() || samples.type() != CV_8UC1 || samples.cols != cellWidth * cellHeight)
+        return false;
+
+    m_cellWidth = cellWidth;
+    m_cellHeight = cellHeight;
+    m_inputLength = (cellWidth / m_factor) * (cellHeight / m_factor);
+    if(components <= 0 || components > std::min(m_inputLength, samples.rows))
+    {
+        clear();
+        return false;
+    }
+
+    cv::Mat reduced(samples.rows, m_inputLength, CV_32F);
+    for(int i = 0; i < samples.rows; ++i)
+        downsample(samples.ptr(i), reduced.ptr<float>(i));
+
+    cv::PCA pca(reduced, cv::Mat(), cv::PCA::DATA_AS_ROW, components);
+    cv::Mat projected = pca.project(reduced);
+
+    // One common scale for all components maps the training projections into [-127, 127]
+    double minValue = 0.0;
+    double maxValue = 0.0;
+    cv::minMaxLoc(projected, &minValue, &maxValue);
+    const double range = std::max(std::abs(minValue), std::abs(maxValue));
+    const double scale = (range > 0.0) ? 127.0 / range : 1.0;
+
+    m_components = pca.eigenvectors.rows;
+    m_mean.assign(pca.mean.ptr<float>(), pca.mean.ptr<float>() + m_inputLength);
+    m_basis.resize(static_cast<size_t>(m_components) * m_inputLength);
+    for(int c = 0; c < m_components; ++c)
+        for(int i = 0; i < m_inputLength; ++i)
+            m_basis[c * m_inputLength + i] = static_cast<float>(pca.eigenvectors.at<float>(c, i) * scale);
+    return true;
+}
+
+bool FeatureProjection::load(const cv::Mat& mean, const cv::Mat& basis, const int cellWidth, const int cellHeight)
+{
+    clear();
+    const int inputLength = (cellWidth / m_factor) * (cellHeight / m_factor);
+    if(mean.type() != CV_32FC1 || basis.type() != CV_32FC1 || mean.total() != static_cast<size_t>(inputLength) ||
+       basis.cols != inputLength || basis.rows == 0)
+        return false;
+
+    m_cellWidth = cellWidth;
+    m_cellHeight = cellHeight;
+    m_inputLength = inputLength;
+    m_components = basis.rows;
+    m_mean.resize(m_inputLength);
+    for(int i = 0; i < m_inputLength; ++i)
+        m_mean[i] = mean.at<float>(0, i);
+    m_basis.resize(static_cast<size_t>(m_components) * m_inputLength);
+    for(int c = 0; c < m_components; ++c)
+        std::copy(basis.ptr<float>(c), basis.ptr<float>(c) + m_inputLength, &m_basis[c * m_inputLength]);
+    return true;
+}
+
+void FeatureProjection::clear()
+{
+    m_cellWidth = 0;
+    m_cellHeight = 0;
+    m_inputLength = 0;
+    m_components = 0;
+    m_mean.clear();
+    m_basis.clear();
+}
+
+bool FeatureProjection::empty() const
+{
+    return m_components == 0;
+}
+
+int FeatureProjection::components() const
+{
+    return m_components;
+}
+
+int FeatureProjection::cellLength() const
+{
+    return m_cellWidth * m_cellHeight;
+}
+
+cv::Mat FeatureProjection::mean() const
+{
+    return cv::Mat(1, m_inputLength, CV_32F, const_cast<float*>(m_mean.data())).clone();
+}
+
+cv::Mat FeatureProjection::basis() const
+{
+    return cv::Mat(m_components, m_inputLength, CV_32F, const_cast<float*>(m_basis.data())).clone();
+}
+
+void FeatureProjection::project(const uint8_t* cell, uint8_t* features) const
+{
+    std::vector<float> centered(m_inputLength);
+    downsample(cell, centered.data());
+    for(int i = 0; i < m_inputLength; ++i)
+        centered[i] -= m_mean[i];
+
+    const float* row = m_basis.data();
+    for(int c = 0; c < m_components; ++c, row += m_inputLength)
+    {
+        float dot = 0.0f;
+        for(int i = 0; i < m_inputLength; ++i)
+            dot += row[i] * centered[i];
+        features[c] = cv::saturate_cast<uint8_t>(dot + 128.0f);
+    }
+}
+
+cv::Mat FeatureProjection::project(const cv::Mat& samples) const
+{
+    if(samples.type() != CV_8UC1 || samples.cols != cellLength())
+        return cv::Mat();
+
+    cv::Mat features(samples.rows, m_components, CV_8U);
+    for(int i = 0; i < samples.rows; ++i)
+        project(samples.ptr(i), features.ptr(i));
+    return features;
+}
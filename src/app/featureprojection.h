@@ -0,0 +1,52 @@
+#ifndef FEATUREPROJECTION_H
+#define FEATUREPROJECTION_H
+
+#include <vector>
+#include <cstdint>
+#include <opencv2/core.hpp>
+
+// Compact OCR features: the cell is downsampled by 2 x 2 averaging (20 x 30 --> 10 x 15 = 150 values)
+// and projected onto the leading principal components of the training cells. The projections are
+// quantised to uint8 around 128 with one common scale (folded into the stored basis), so euclidean
+// distances keep their proportions and the features work with the uint8 nearest neighbour engine.
+class FeatureProjection
+{
+private:
+    // Member variables
+    static const int m_factor = 2;      // Downsampling factor in both directions
+
+    int m_cellWidth;
+    int m_cellHeight;
+    int m_inputLength;                  // Length of the downsampled cell
+    int m_components;                   // Feature length
+    std::vector<float> m_mean;          // m_inputLength
+    std::vector<float> m_basis;         // m_components x m_inputLength, scaled for the quantisation
+
+    /* ----------------------- Private member functions ----------------------- */
+    void downsample(const uint8_t* cell, float* output) const;
+
+public:
+    FeatureProjection();    // Constructor
+    ~FeatureProjection();   // Destructor
+
+    /* ----------------------- Public member functions ----------------------- */
+    // Compute the projection from raw training cells (CV_8U, one cell per row)
+    bool fit(const cv::Mat& samples, const int cellWidth, const int cellHeight, const int components);
+
+    // Restore a stored projection (mean and basis as returned by mean() / basis())
+    bool load(const cv::Mat& mean, const cv::Mat& basis, const int cellWidth, const int cellHeight);
+
+    void clear();
+    bool empty() const;
+    int components() const;
+    int cellLength() const;     // Expected length of a raw cell row
+
+    cv::Mat mean() const;       // 1 x inputLength CV_32F
+    cv::Mat basis() const;      // components x inputLength CV_32F
+
+    // Features of one raw cell (cellLength bytes) / of all rows of a CV_8U matrix
+    void project(const uint8_t* cell, uint8_t* features) const;
+    cv::Mat project(const cv::Mat& samples) const;
+};
+
+#endif // FEATUREPROJECTION_H
@@ -0,0 +1,96 @@
+#include "gridverifier.h"
+#include <algorithm>
+
+const int GridVerifier::m_lanes;
+const uint64_t GridVerifier::m_allDigits;
+
+GridVerifier::GridVerifier()
+{
+    // Rows, columns and boxes of a 9x9 grid
+    m_units.resize(27);
+    for(int row = 0; row < 9; ++row)
+    {
+        for(int col = 0; col < 9; ++col)
+        {
+            const int cell = row * 9 + col;
+            m_units[row].push_back(cell);
+            m_units[9 + col].push_back(cell);
+            m_units[18 + (row / 3) * 3 + col / 3].push_back(cell);
+        }
+    }
+
+    // Low nibble = even cell, high nibble = odd cell; digit d becomes bit d
+    for(int byte = 0; byte < 256; ++byte)
+        m_pairMasks[byte] = (1u << (byte & 0xF)) | ((1u << (byte >> 4)) << 16);
+}
+
+GridVerifier::~GridVerifier(){}
+
+// Returns the lanes (bits 1-9 of each lane) that have every digit in every unit
+uint64_t GridVerifier::checkLanes(const uint64_t* cellMasks) const
+{
+    // A unit of nine cells that contains all digits 1-9 cannot hold anything else
+    uint64_t valid = m_allDigits;
+    for(const auto& unit : m_units)
+    {
+        uint64_t digits = 0;
+        for(const int cell : unit)
+            digits |= cellMasks[cell];
+        valid &= digits;
+    }
+    return valid;
+}
+
+bool GridVerifier::isValidSolution(const std::vector<int>& grid) const
+{
+    if(grid.size() != 81)
+        return false;
+
+    uint64_t cellMasks[81];
+    for(int cell = 0; cell < 81; ++cell)
+    {
+        const int digit = grid[cell];
+        cellMasks[cell] = (digit >= 0 && digit < 16) ? (1ull << digit) : 1ull;
+    }
+    return (checkLanes(cellMasks) & 0xFFFF) == 0x03FE;
+}
+
+size_t GridVerifier::verify(const PackedGridArray& grids, std::vector<uint8_t>& valid) const
+{
+    const size_t count = grids.size();
+    valid.assign(count, 0);
+    size_t correct = 0;
+
+    uint64_t cellMasks[81];
+    for(size_t first = 0; first < count; first += m_lanes)
+    {
+        // Interleave the one-hot digit masks of up to four grids into the lanes
+        for(int cell = 0; cell < 81; ++cell)
+            cellMasks[cell] = 0;
+
+        const size_t lanes = std::min(static_cast<size_t>(m_lanes), count - first);
+        for(size_t lane = 0; lane < lanes; ++lane)
+        {
+            const uint8_t* bytes = grids.grid(first + lane);
+            const int shift = static_cast<int>(16 * lane);
+            for(int i = 0; i < PackedGrid::m_bytes - 1; ++i)
+            {
+                const uint32_t pair = m_pairMasks[bytes[i]];
+                cellMasks[2 * i] |= static_cast<uint64_t>(pair & 0xFFFF) << shift;
+                cellMasks[2 * i + 1] |= static_cast<uint64_t>(pair >> 16) << shift;
+            }
+            cellMasks[80] |= static_cast<uint64_t>(m_pairMasks[bytes[PackedGrid::m_bytes - 1]] & 0xFFFF) << shift;
+        }
+
+        const uint64_t lanesValid = checkLanes(cellMasks);
+        for(size_t lane = 0; lane < lanes; ++lane)
+        {
+            if(((lanesValid >> (16 * lane)) & 0xFFFF) == 0x03FE)
+            {
+                valid[first + lane] = 1;
+                ++correct;
+            }
+        }
+    }
+    return correct;
+}
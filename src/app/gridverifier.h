@@ -0,0 +1,37 @@
+#ifndef GRIDVERIFIER_H
+#define GRIDVERIFIER_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "packedgrid.h"
+
+// Bulk correctness check of completed 9x9 grids (same rules as Solver::checker: every row,
+// column and box holds the digits 1-9 exactly once). Digit masks of four grids are accumulated
+// side by side in the 16 bit lanes of one 64 bit word, so every OR checks four grids at once.
+class GridVerifier
+{
+private:
+    // Member variables
+    static const int m_lanes = 4;   // Grids per 64 bit word
+    static const uint64_t m_allDigits = 0x03FE03FE03FE03FEull;  // Bits 1-9 in every lane
+
+    std::vector<std::vector<int>> m_units;  // Cell indices of the 27 rows, columns and boxes
+    uint32_t m_pairMasks[256];              // Packed byte --> one-hot masks of its two cells
+
+    /* ----------------------- Private member functions ----------------------- */
+    uint64_t checkLanes(const uint64_t* cellMasks) const;
+
+public:
+    GridVerifier();     // Constructor
+    ~GridVerifier();    // Destructor
+
+    /* ----------------------- Public member functions ----------------------- */
+    // Single grid in the working representation
+    bool isValidSolution(const std::vector<int>& grid) const;
+
+    // Checks all grids, valid[i] is 1 for a correct grid; returns the number of correct grids
+    size_t verify(const PackedGridArray& grids, std::vector<uint8_t>& valid) const;
+};
+
+#endif // GRIDVERIFIER_H
@@ -0,0 +1,141 @@
+#include "hammingclassifier.h"
+#include "bitutils.h"
+#include <limits>
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+HammingClassifier::HammingClassifier()
+    : m_dims(0)
+    , m_words(0)
+    , m_count(0)
+    , m_threshold(128)
+{}
+
+HammingClassifier::~HammingClassifier(){}
+
+// One bit per pixel, pixel i goes to bit (i % 64) of word (i / 64)
+void HammingClassifier::pack(const uint8_t* features, uint64_t* signature) const
+{
+    for(int w = 0; w < m_words; ++w)
+        signature[w] = 0;
+
+    int i = 0;
+#if defined(__SSE2__) || defined(_M_X64)
+    // 16 pixels at a time: x >= threshold <=> max(x, threshold) == x, movemask gathers the bits
+    const __m128i threshold = _mm_set1_epi8(static_cast<char>(m_threshold));
+    for(; i + 16 <= m_dims; i += 16)
+    {
+        const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(features + i));
+        const uint64_t bits = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(x, threshold), x)));
+        signature[i / 64] |= bits << (i % 64);
+    }
+#endif
+    for(; i < m_dims; ++i)
+        signature[i / 64] |= static_cast<uint64_t>(features[i] >= m_threshold) << (i % 64);
+}
+
+void HammingClassifier::train(const uint8_t* samples, const size_t sampleStep, const int count, const int dims, const int* labels,
+                              const uint8_t threshold)
+{
+    m_dims = dims;
+    m_words = (dims + 63) / 64;
+    m_count = count;
+    m_threshold = threshold;
+    m_signatures.assign(static_cast<size_t>(count) * m_words, 0);
+    m_labels.assign(labels, labels + count);
+
+    for(int i = 0; i < count; ++i)
+        pack(samples + i * sampleStep, &m_signatures[static_cast<size_t>(i) * m_words]);
+}
+
+bool HammingClassifier::train(const cv::Mat& samples, const cv::Mat& labels)
+{
+    if(samples.empty() || samples.type() != CV_8UC1 || labels.type() != CV_32SC1 || labels.total() != static_cast<size_t>(samples.rows))
+        return false;
+
+    const cv::Mat continuousLabels = labels.isContinuous() ? labels : labels.clone();
+    train(samples.ptr(), samples.step, samples.rows, samples.cols, continuousLabels.ptr<int>());
+    return true;
+}
+
+std::vector<CellPrediction> HammingClassifier::classify(const cv::Mat& samples) const
+{
+    std::vector<CellPrediction> predictions;
+    if(empty() || samples.type() != CV_8UC1 || samples.cols != m_dims)
+        return predictions;
+
+    std::vector<NeighbourMatch> matches(samples.rows);
+    findNearest(samples.ptr(), samples.step, samples.rows, matches.data());
+
+    // Confidence on the number of differing pixels
+    predictions.reserve(matches.size());
+    for(const NeighbourMatch& match : matches)
+        predictions.push_back(CellPrediction{char(match.label), char(match.runnerUp),
+                                             distanceConfidence(static_cast<float>(match.distance),
+                                                                static_cast<float>(match.runnerUpDistance),
+                                                                match.runnerUp != 0)});
+    return predictions;
+}
+
+bool HammingClassifier::empty() const
+{
+    return m_count == 0;
+}
+
+int HammingClassifier::dims() const
+{
+    return m_dims;
+}
+
+int HammingClassifier::count() const
+{
+    return m_count;
+}
+
+void HammingClassifier::findNearest(const uint8_t* queries, const size_t queryStep, const int queryCount, int* labels) const
+{
+    std::vector<NeighbourMatch> matches(queryCount > 0 ? queryCount : 0);
+    findNearest(queries, queryStep, queryCount, matches.data());
+    for(int q = 0; q < queryCount; ++q)
+        labels[q] = matches[q].label;
+}
+
+void HammingClassifier::findNearest(const uint8_t* queries, const size_t queryStep, const int queryCount, NeighbourMatch* matches) const
+{
+    // The whole packed training set (218 x 80 bytes) fits into L1, no blocking needed
+    const uint32_t maxDistance = std::numeric_limits<uint32_t>::max();
+    std::vector<uint64_t> query(m_words);
+    for(int q = 0; q < queryCount; ++q)
+    {
+        pack(queries + q * queryStep, query.data());
+
+        NeighbourMatch match = {0, 0, maxDistance, maxDistance};
+        const uint64_t* signature = m_signatures.data();
+        for(int i = 0; i < m_count; ++i, signature += m_words)
+        {
+            uint32_t distance = 0;
+            for(int w = 0; w < m_words; ++w)
+                distance += static_cast<uint32_t>(popCount64(query[w] ^ signature[w]));
+
+            // Same bookkeeping as NearestNeighbour::findNearest
+            const int label = m_labels[i];
+            if(distance <= match.distance)
+            {
+                if(label != match.label)
+                {
+                    match.runnerUp = match.label;
+                    match.runnerUpDistance = match.distance;
+                }
+                match.label = label;
+                match.distance = distance;
+            }
+            else if(label != match.label && distance <= match.runnerUpDistance)
+            {
+                match.runnerUp = label;
+                match.runnerUpDistance = distance;
+            }
+        }
+        matches[q] = match;
+    }
+}
@@ -0,0 +1,52 @@
+#ifndef HAMMINGCLASSIFIER_H
+#define HAMMINGCLASSIFIER_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "nearestneighbour.h"
+
+// 1-nearest-neighbour search on binary signatures. Every feature vector is thresholded
+// into one bit per pixel (a 20 x 30 cell becomes 10 uint64 words) and the distance of
+// two signatures is the popcount of their XOR. This reads 80 bytes per comparison
+// instead of 600 bytes (uint8) or 2400 bytes (float).
+class HammingClassifier : public DigitClassifier
+{
+private:
+    // Member variables
+    int m_dims;                         // Feature length in pixels
+    int m_words;                        // uint64 words per signature
+    int m_count;                        // Number of training samples
+    uint8_t m_threshold;                // Pixels >= threshold are set bits
+    std::vector<uint64_t> m_signatures; // m_count x m_words
+    std::vector<int> m_labels;
+
+    /* ----------------------- Private member functions ----------------------- */
+    void pack(const uint8_t* features, uint64_t* signature) const;
+
+public:
+    HammingClassifier();    // Constructor
+    ~HammingClassifier();   // Destructor
+
+    /* ----------------------- Public member functions ----------------------- */
+    // Pack the training samples (count rows of dims bytes, sampleStep bytes apart) into signatures
+    void train(const uint8_t* samples, const size_t sampleStep, const int count, const int dims, const int* labels,
+               const uint8_t threshold = 128);
+
+    bool empty() const override;
+    int dims() const override;
+    int count() const;
+
+    // DigitClassifier interface (CV_8U samples, CV_32S labels)
+    bool train(const cv::Mat& samples, const cv::Mat& labels) override;
+    std::vector<CellPrediction> classify(const cv::Mat& samples) const override;
+
+    // Label of the training signature with the smallest Hamming distance for every query row,
+    // ties go to the later training sample (same rule as NearestNeighbour)
+    void findNearest(const uint8_t* queries, const size_t queryStep, const int queryCount, int* labels) const;
+
+    // Same search, also keeps the runner-up label and both distances (number of differing pixels)
+    void findNearest(const uint8_t* queries, const size_t queryStep, const int queryCount, NeighbourMatch* matches) const;
+};
+
+#endif // HAMMINGCLASSIFIER_H
@@ -0,0 +1,496 @@
+#include "mlpclassifier.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <numeric>
+#include <random>
+#include <utility>
+#if defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#endif
+
+namespace
+{
+const int batchSize = 16;
+const float learningRate = 0.02f;   // Decays linearly to 0 over the epochs
+const float momentum = 0.9f;
+const float weightDecay = 1e-4f;
+const unsigned int seed = 0x5eed;
+
+// Ranges of the random warp of the training cells
+const float maxRotation = 10.0f * 3.14159265f / 180.0f;
+const float maxScale = 0.1f;        // Relative
+const float maxShear = 0.15f;
+const float maxShift = 1.5f;        // Pixels
+
+int padTo32(const int length)
+{
+    return (length + 31) / 32 * 32;
+}
+}
+
+MlpClassifier::MlpClassifier(const int hiddenUnits, const int epochs, const int cellWidth, const int cellHeight)
+    : m_hiddenUnits(hiddenUnits)
+    , m_epochs(epochs)
+    , m_cellWidth(cellWidth)
+    , m_cellHeight(cellHeight)
+    , m_dims(0)
+    , m_inputStride(0)
+    , m_hidden(0)
+    , m_hiddenStride(0)
+{}
+
+MlpClassifier::~MlpClassifier(){}
+
+// Sum of inputs[i] * weights[i] over a zero padded stride (multiple of 32). The inputs must
+// be <= 127, then the int16 pair sums of maddubs stay below 2 * 127 * 128 < 32768.
+int32_t MlpClassifier::dot(const uint8_t* inputs, const int8_t* weights, const int stride)
+{
+#if defined(__AVX2__)
+    const __m256i ones = _mm256_set1_epi16(1);
+    __m256i sum = _mm256_setzero_si256();
+    for(int i = 0; i < stride; i += 32)
+    {
+        const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(inputs + i));
+        const __m256i w = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(weights + i));
+        sum = _mm256_add_epi32(sum, _mm256_madd_epi16(_mm256_maddubs_epi16(x, w), ones));
+    }
+    __m128i total = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    total = _mm_add_epi32(total, _mm_shuffle_epi32(total, _MM_SHUFFLE(1, 0, 3, 2)));
+    total = _mm_add_epi32(total, _mm_shuffle_epi32(total, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(total);
+#elif defined(__SSE2__) || defined(_M_X64)
+    // No maddubs in SSE2: widen both operands to int16 (sign extension of the weights)
+    const __m128i zero = _mm_setzero_si128();
+    __m128i sum = _mm_setzero_si128();
+    for(int i = 0; i < stride; i += 16)
+    {
+        const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(inputs + i));
+        const __m128i w = _mm_loadu_si128(reinterpret_cast<const __m128i*>(weights + i));
+        const __m128i sign = _mm_cmpgt_epi8(zero, w);
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_unpacklo_epi8(x, zero), _mm_unpacklo_epi8(w, sign)));
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_unpackhi_epi8(x, zero), _mm_unpackhi_epi8(w, sign)));
+    }
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(sum);
+#else
+    int32_t sum = 0;
+    for(int i = 0; i < stride; ++i)
+        sum += static_cast<int32_t>(inputs[i]) * weights[i];
+    return sum;
+#endif
+}
+
+void MlpClassifier::augment(const uint8_t* cell, float* inputs, std::mt19937& random) const
+{
+    std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+    const float angle = maxRotation * uniform(random);
+    const float scale = 1.0f + maxScale * uniform(random);
+    const float shear = maxShear * uniform(random);
+    const float shiftX = maxShift * uniform(random);
+    const float shiftY = maxShift * uniform(random);
+
+    // Source position of every output pixel: rotation * shear * scale around the cell centre, plus shift
+    const float a = scale * std::cos(angle);
+    const float b = scale * std::sin(angle);
+    const float m00 = a, m01 = a * shear - b;
+    const float m10 = b, m11 = b * shear + a;
+    const float centreX = (m_cellWidth - 1) / 2.0f;
+    const float centreY = (m_cellHeight - 1) / 2.0f;
+
+    for(int y = 0; y < m_cellHeight; ++y)
+    {
+        for(int x = 0; x < m_cellWidth; ++x)
+        {
+            const float sourceX = m00 * (x - centreX) + m01 * (y - centreY) + centreX + shiftX;
+            const float sourceY = m10 * (x - centreX) + m11 * (y - centreY) + centreY + shiftY;
+            const int x0 = static_cast<int>(std::floor(sourceX));
+            const int y0 = static_cast<int>(std::floor(sourceY));
+            const float fx = sourceX - x0;
+            const float fy = sourceY - y0;
+
+            // Bilinear interpolation, pixels outside the cell are background (0)
+            float value = 0.0f;
+            for(int dy = 0; dy < 2; ++dy)
+            {
+                for(int dx = 0; dx < 2; ++dx)
+                {
+                    const int px = x0 + dx;
+                    const int py = y0 + dy;
+                    if(px >= 0 && px < m_cellWidth && py >= 0 && py < m_cellHeight)
+                        value += (dx ? fx : 1.0f - fx) * (dy ? fy : 1.0f - fy) * cell[py * m_cellWidth + px];
+                }
+            }
+
+            // Same 7 bit reduction as the quantised inference
+            inputs[y * m_cellWidth + x] = (static_cast<int>(value + 0.5f) >> 1) / 127.0f;
+        }
+    }
+}
+
+bool MlpClassifier::empty() const
+{
+    return m_labels.empty();
+}
+
+int MlpClassifier::dims() const
+{
+    return m_dims;
+}
+
+bool MlpClassifier::train(const cv::Mat& samples, const cv::Mat& labels)
+{
+    if(samples.empty() || samples.type() != CV_8UC1 || labels.type() != CV_32SC1 || labels.total() != static_cast<size_t>(samples.rows) ||
+       m_hiddenUnits <= 0 || m_epochs <= 0)
+        return false;
+
+    // One output per label, in ascending order
+    std::map<int, int> classIndex;
+    for(int i = 0; i < samples.rows; ++i)
+        classIndex[labels.at<int>(i)] = 0;
+    std::vector<int> classLabels;
+    for(auto& entry : classIndex)
+    {
+        entry.second = static_cast<int>(classLabels.size());
+        classLabels.push_back(entry.first);
+    }
+
+    // The network sees the same 7 bit inputs as the quantised inference, scaled to [0, 1]
+    const int count = samples.rows;
+    const int dims = samples.cols;
+    const int hidden = m_hiddenUnits;
+    const int classes = static_cast<int>(classLabels.size());
+    std::vector<float> inputs(static_cast<size_t>(count) * dims);
+    std::vector<int> targets(count);
+    for(int i = 0; i < count; ++i)
+    {
+        const uint8_t* row = samples.ptr(i);
+        for(int j = 0; j < dims; ++j)
+            inputs[static_cast<size_t>(i) * dims + j] = (row[j] >> 1) / 127.0f;
+        targets[i] = classIndex[labels.at<int>(i)];
+    }
+
+    // He initialisation
+    std::mt19937 random(seed);
+    std::normal_distribution<float> hiddenInit(0.0f, std::sqrt(2.0f / dims));
+    std::normal_distribution<float> outputInit(0.0f, std::sqrt(2.0f / hidden));
+    std::vector<float> hiddenWeights(static_cast<size_t>(hidden) * dims);
+    std::vector<float> hiddenBias(hidden, 0.0f);
+    std::vector<float> outputWeights(static_cast<size_t>(classes) * hidden);
+    std::vector<float> outputBias(classes, 0.0f);
+    for(float& weight : hiddenWeights)
+        weight = hiddenInit(random);
+    for(float& weight : outputWeights)
+        weight = outputInit(random);
+
+    // Gradients and momentum of all parameters
+    std::vector<float> hiddenWeightsGrad(hiddenWeights.size()), hiddenWeightsVelocity(hiddenWeights.size(), 0.0f);
+    std::vector<float> hiddenBiasGrad(hidden), hiddenBiasVelocity(hidden, 0.0f);
+    std::vector<float> outputWeightsGrad(outputWeights.size()), outputWeightsVelocity(outputWeights.size(), 0.0f);
+    std::vector<float> outputBiasGrad(classes), outputBiasVelocity(classes, 0.0f);
+    const auto update = [](std::vector<float>& values, std::vector<float>& grad, std::vector<float>& velocity,
+                           const float rate, const float decay)
+    {
+        for(size_t i = 0; i < values.size(); ++i)
+        {
+            velocity[i] = momentum * velocity[i] - rate * (grad[i] + decay * values[i]);
+            values[i] += velocity[i];
+        }
+    };
+
+    std::vector<int> order(count);
+    std::iota(order.begin(), order.end(), 0);
+    std::vector<float> activation(hidden);
+    std::vector<float> output(classes);
+    std::vector<float> delta(hidden);
+
+    // Raw cells get a new random warp in every epoch
+    const bool augmented = m_cellWidth > 0 && m_cellHeight > 0 && dims == m_cellWidth * m_cellHeight;
+    std::vector<float> warped(augmented ? inputs.size() : 0);
+    const std::vector<float>& epochInputs = augmented ? warped : inputs;
+    for(int epoch = 0; epoch < m_epochs; ++epoch)
+    {
+        const float rate = learningRate * (1.0f - static_cast<float>(epoch) / m_epochs);
+        if(augmented)
+        {
+            for(int i = 0; i < count; ++i)
+                augment(samples.ptr(i), &warped[static_cast<size_t>(i) * dims], random);
+        }
+        std::shuffle(order.begin(), order.end(), random);
+
+        for(int first = 0; first < count; first += batchSize)
+        {
+            const int last = std::min(first + batchSize, count);
+            std::fill(hiddenWeightsGrad.begin(), hiddenWeightsGrad.end(), 0.0f);
+            std::fill(hiddenBiasGrad.begin(), hiddenBiasGrad.end(), 0.0f);
+            std::fill(outputWeightsGrad.begin(), outputWeightsGrad.end(), 0.0f);
+            std::fill(outputBiasGrad.begin(), outputBiasGrad.end(), 0.0f);
+
+            for(int b = first; b < last; ++b)
+            {
+                const int sample = order[b];
+                const float* x = &epochInputs[static_cast<size_t>(sample) * dims];
+
+                // Forward
+                for(int j = 0; j < hidden; ++j)
+                {
+                    const float* weights = &hiddenWeights[static_cast<size_t>(j) * dims];
+                    float sum = hiddenBias[j];
+                    for(int i = 0; i < dims; ++i)
+                        sum += weights[i] * x[i];
+                    activation[j] = std::max(sum, 0.0f);
+                }
+                float maxLogit = -std::numeric_limits<float>::max();
+                for(int k = 0; k < classes; ++k)
+                {
+                    const float* weights = &outputWeights[static_cast<size_t>(k) * hidden];
+                    float sum = outputBias[k];
+                    for(int j = 0; j < hidden; ++j)
+                        sum += weights[j] * activation[j];
+                    output[k] = sum;
+                    maxLogit = std::max(maxLogit, sum);
+                }
+                float total = 0.0f;
+                for(int k = 0; k < classes; ++k)
+                {
+                    output[k] = std::exp(output[k] - maxLogit);
+                    total += output[k];
+                }
+
+                // Softmax cross entropy gradient: probability - one hot target, averaged over the batch
+                for(int k = 0; k < classes; ++k)
+                    output[k] = (output[k] / total - (k == targets[sample] ? 1.0f : 0.0f)) / (last - first);
+
+                for(int k = 0; k < classes; ++k)
+                {
+                    float* grad = &outputWeightsGrad[static_cast<size_t>(k) * hidden];
+                    for(int j = 0; j < hidden; ++j)
+                        grad[j] += output[k] * activation[j];
+                    outputBiasGrad[k] += output[k];
+                }
+                for(int j = 0; j < hidden; ++j)
+                {
+                    delta[j] = 0.0f;
+                    if(activation[j] > 0.0f)
+                    {
+                        for(int k = 0; k < classes; ++k)
+                            delta[j] += output[k] * outputWeights[static_cast<size_t>(k) * hidden + j];
+                    }
+                }
+                for(int j = 0; j < hidden; ++j)
+                {
+                    if(delta[j] == 0.0f)
+                        continue;
+                    float* grad = &hiddenWeightsGrad[static_cast<size_t>(j) * dims];
+                    for(int i = 0; i < dims; ++i)
+                        grad[i] += delta[j] * x[i];
+                    hiddenBiasGrad[j] += delta[j];
+                }
+            }
+
+            update(hiddenWeights, hiddenWeightsGrad, hiddenWeightsVelocity, rate, weightDecay);
+            update(hiddenBias, hiddenBiasGrad, hiddenBiasVelocity, rate, 0.0f);
+            update(outputWeights, outputWeightsGrad, outputWeightsVelocity, rate, weightDecay);
+            update(outputBias, outputBiasGrad, outputBiasVelocity, rate, 0.0f);
+        }
+    }
+
+    m_dims = dims;
+    m_hidden = hidden;
+    m_labels = classLabels;
+    quantise(hiddenWeights, hiddenBias, outputWeights, outputBias, inputs, count);
+    return true;
+}
+
+// Symmetric int8 quantisation per unit. The hidden activations are mapped to [0, 127] with the
+// largest activation on the training inputs, both scales are folded into the float parameters.
+void MlpClassifier::quantise(const std::vector<float>& hiddenWeights, const std::vector<float>& hiddenBias,
+                             const std::vector<float>& outputWeights, const std::vector<float>& outputBias,
+                             const std::vector<float>& inputs, const int count)
+{
+    const int classes = static_cast<int>(m_labels.size());
+    m_inputStride = padTo32(m_dims);
+    m_hiddenStride = padTo32(m_hidden);
+
+    float maxActivation = 0.0f;
+    for(int s = 0; s < count; ++s)
+    {
+        const float* x = &inputs[static_cast<size_t>(s) * m_dims];
+        for(int j = 0; j < m_hidden; ++j)
+        {
+            const float* weights = &hiddenWeights[static_cast<size_t>(j) * m_dims];
+            float sum = hiddenBias[j];
+            for(int i = 0; i < m_dims; ++i)
+                sum += weights[i] * x[i];
+            maxActivation = std::max(maxActivation, sum);
+        }
+    }
+    const float activationScale = std::max(maxActivation, 1e-6f) / 127.0f;
+
+    // Integer input q = 127 * x, so the float sum is dot * weightScale / 127
+    m_hiddenWeights.assign(static_cast<size_t>(m_hidden) * m_inputStride, 0);
+    m_hiddenScale.resize(m_hidden);
+    m_hiddenBias.resize(m_hidden);
+    for(int j = 0; j < m_hidden; ++j)
+    {
+        const float* weights = &hiddenWeights[static_cast<size_t>(j) * m_dims];
+        float maxWeight = 0.0f;
+        for(int i = 0; i < m_dims; ++i)
+            maxWeight = std::max(maxWeight, std::abs(weights[i]));
+        const float weightScale = (maxWeight > 0.0f) ? maxWeight / 127.0f : 1.0f;
+
+        for(int i = 0; i < m_dims; ++i)
+            m_hiddenWeights[static_cast<size_t>(j) * m_inputStride + i] = static_cast<int8_t>(std::lround(weights[i] / weightScale));
+        m_hiddenScale[j] = weightScale / 127.0f / activationScale;
+        m_hiddenBias[j] = hiddenBias[j] / activationScale;
+    }
+
+    m_outputWeights.assign(static_cast<size_t>(classes) * m_hiddenStride, 0);
+    m_outputScale.resize(classes);
+    m_outputBias.assign(outputBias.begin(), outputBias.end());
+    for(int k = 0; k < classes; ++k)
+    {
+        const float* weights = &outputWeights[static_cast<size_t>(k) * m_hidden];
+        float maxWeight = 0.0f;
+        for(int j = 0; j < m_hidden; ++j)
+            maxWeight = std::max(maxWeight, std::abs(weights[j]));
+        const float weightScale = (maxWeight > 0.0f) ? maxWeight / 127.0f : 1.0f;
+
+        for(int j = 0; j < m_hidden; ++j)
+            m_outputWeights[static_cast<size_t>(k) * m_hiddenStride + j] = static_cast<int8_t>(std::lround(weights[j] / weightScale));
+        m_outputScale[k] = weightScale * activationScale;
+    }
+}
+
+CellPrediction MlpClassifier::predict(const uint8_t* features, uint8_t* input, uint8_t* hidden, float* logits) const
+{
+    for(int i = 0; i < m_dims; ++i)
+        input[i] = features[i] >> 1;
+
+    for(int j = 0; j < m_hidden; ++j)
+    {
+        const float value = dot(input, &m_hiddenWeights[static_cast<size_t>(j) * m_inputStride], m_inputStride) * m_hiddenScale[j] + m_hiddenBias[j];
+        hidden[j] = (value <= 0.0f) ? 0 : static_cast<uint8_t>(std::min(127, static_cast<int>(value + 0.5f)));
+    }
+
+    // Two largest logits give label and runner-up, the softmax only their confidence
+    const int classes = static_cast<int>(m_labels.size());
+    int best = 0;
+    int second = -1;
+    for(int k = 0; k < classes; ++k)
+    {
+        logits[k] = dot(hidden, &m_outputWeights[static_cast<size_t>(k) * m_hiddenStride], m_hiddenStride) * m_outputScale[k] + m_outputBias[k];
+        if(logits[k] > logits[best])
+        {
+            second = best;
+            best = k;
+        }
+        else if(k != best && (second < 0 || logits[k] > logits[second]))
+            second = k;
+    }
+    if(second < 0)
+        return CellPrediction{char(m_labels[best]), char(0), 1.0f};
+
+    float total = 0.0f;
+    for(int k = 0; k < classes; ++k)
+        total += std::exp(logits[k] - logits[best]);
+    const float confidence = (1.0f - std::exp(logits[second] - logits[best])) / total;
+    return CellPrediction{char(m_labels[best]), char(m_labels[second]), confidence};
+}
+
+std::vector<CellPrediction> MlpClassifier::classify(const cv::Mat& samples) const
+{
+    std::vector<CellPrediction> predictions;
+    if(empty() || samples.type() != CV_8UC1 || samples.cols != m_dims)
+        return predictions;
+
+    // Scratch buffers for the whole batch, the padding of input and hidden stays zero
+    std::vector<uint8_t> input(m_inputStride, 0);
+    std::vector<uint8_t> hidden(m_hiddenStride, 0);
+    std::vector<float> logits(m_labels.size());
+    predictions.reserve(samples.rows);
+    for(int i = 0; i < samples.rows; ++i)
+        predictions.push_back(predict(samples.ptr(i), input.data(), hidden.data(), logits.data()));
+    return predictions;
+}
+
+bool MlpClassifier::load(const ModelFile& model)
+{
+    const cv::Mat hiddenWeights = model.networkHiddenWeights();
+    const cv::Mat hiddenParams = model.networkHiddenParams();
+    const cv::Mat outputWeights = model.networkOutputWeights();
+    const cv::Mat outputParams = model.networkOutputParams();
+    if(hiddenWeights.empty() || hiddenParams.empty() || outputWeights.empty() || outputParams.empty())
+        return false;
+
+    // The network has to match the features of the samples in the same model
+    const int hidden = hiddenWeights.rows;
+    const int classes = outputWeights.rows;
+    if(hiddenWeights.type() != CV_8SC1 || hiddenWeights.cols != model.samples().cols ||
+       hiddenParams.type() != CV_32FC1 || hiddenParams.rows != 2 || hiddenParams.cols != hidden ||
+       outputWeights.type() != CV_8SC1 || outputWeights.cols != hidden ||
+       outputParams.type() != CV_32FC1 || outputParams.rows != 3 || outputParams.cols != classes)
+    {
+        std::cout << "Error: Network sections of the model do not match!" << std::endl;
+        return false;
+    }
+
+    m_dims = hiddenWeights.cols;
+    m_hidden = hidden;
+    m_inputStride = padTo32(m_dims);
+    m_hiddenStride = padTo32(m_hidden);
+
+    m_hiddenWeights.assign(static_cast<size_t>(m_hidden) * m_inputStride, 0);
+    for(int j = 0; j < m_hidden; ++j)
+        std::copy(hiddenWeights.ptr<int8_t>(j), hiddenWeights.ptr<int8_t>(j) + m_dims, &m_hiddenWeights[static_cast<size_t>(j) * m_inputStride]);
+    m_hiddenScale.assign(hiddenParams.ptr<float>(0), hiddenParams.ptr<float>(0) + hidden);
+    m_hiddenBias.assign(hiddenParams.ptr<float>(1), hiddenParams.ptr<float>(1) + hidden);
+
+    m_outputWeights.assign(static_cast<size_t>(classes) * m_hiddenStride, 0);
+    for(int k = 0; k < classes; ++k)
+        std::copy(outputWeights.ptr<int8_t>(k), outputWeights.ptr<int8_t>(k) + hidden, &m_outputWeights[static_cast<size_t>(k) * m_hiddenStride]);
+    m_outputScale.assign(outputParams.ptr<float>(0), outputParams.ptr<float>(0) + classes);
+    m_outputBias.assign(outputParams.ptr<float>(1), outputParams.ptr<float>(1) + classes);
+    m_labels.resize(classes);
+    for(int k = 0; k < classes; ++k)
+        m_labels[k] = static_cast<int>(outputParams.at<float>(2, k));
+    return true;
+}
+
+ModelPayloads MlpClassifier::parameters() const
+{
+    ModelPayloads payloads;
+    if(empty())
+        return payloads;
+
+    const int classes = static_cast<int>(m_labels.size());
+    cv::Mat hiddenWeights(m_hidden, m_dims, CV_8SC1);
+    cv::Mat hiddenParams(2, m_hidden, CV_32FC1);
+    for(int j = 0; j < m_hidden; ++j)
+    {
+        std::copy(&m_hiddenWeights[static_cast<size_t>(j) * m_inputStride], &m_hiddenWeights[static_cast<size_t>(j) * m_inputStride] + m_dims,
+                  hiddenWeights.ptr<int8_t>(j));
+        hiddenParams.at<float>(0, j) = m_hiddenScale[j];
+        hiddenParams.at<float>(1, j) = m_hiddenBias[j];
+    }
+
+    cv::Mat outputWeights(classes, m_hidden, CV_8SC1);
+    cv::Mat outputParams(3, classes, CV_32FC1);
+    for(int k = 0; k < classes; ++k)
+    {
+        std::copy(&m_outputWeights[static_cast<size_t>(k) * m_hiddenStride], &m_outputWeights[static_cast<size_t>(k) * m_hiddenStride] + m_hidden,
+                  outputWeights.ptr<int8_t>(k));
+        outputParams.at<float>(0, k) = m_outputScale[k];
+        outputParams.at<float>(1, k) = m_outputBias[k];
+        outputParams.at<float>(2, k) = static_cast<float>(m_labels[k]);
+    }
+
+    payloads.push_back(std::make_pair(ModelSectionType::NetworkHiddenWeights, hiddenWeights));
+    payloads.push_back(std::make_pair(ModelSectionType::NetworkHiddenParams, hiddenParams));
+    payloads.push_back(std::make_pair(ModelSectionType::NetworkOutputWeights, outputWeights));
+    payloads.push_back(std::make_pair(ModelSectionType::NetworkOutputParams, outputParams));
+    return payloads;
+}
@@ -0,0 +1,70 @@
+#ifndef MLPCLASSIFIER_H
+#define MLPCLASSIFIER_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <random>
+#include "digitclassifier.h"
+
+// Small neural network (features --> hidden ReLU layer --> one output per digit) with int8 weights.
+// Training runs in float (mini-batch SGD with momentum on the softmax loss), afterwards the weights
+// are quantised per unit. Raw cells (cellWidth x cellHeight features) are randomly rotated, scaled,
+// sheared and shifted in every epoch, so the network does not learn the exact pixel positions of
+// the few real training cells (projected features are used as they are).
+// Inference is integer only: the inputs are reduced to 7 bits so that the products of two
+// neighbouring uint8 x int8 pairs cannot saturate in int16 (_mm256_maddubs_epi16), the hidden
+// activations are requantised to 7 bits as well. The cost per cell does not depend on the number
+// of training samples (hidden x padded feature length multiply-adds).
+class MlpClassifier : public DigitClassifier
+{
+private:
+    // Member variables
+    int m_hiddenUnits;                  // Size of the hidden layer used by train
+    int m_epochs;
+    int m_cellWidth;                    // Cell size for the augmentation of raw cells
+    int m_cellHeight;
+
+    int m_dims;                         // Feature length
+    int m_inputStride;                  // Padded feature length (multiple of 32)
+    int m_hidden;                       // Hidden units of the current network
+    int m_hiddenStride;                 // Padded hidden length (multiple of 32)
+    std::vector<int8_t> m_hiddenWeights;    // m_hidden x m_inputStride
+    std::vector<float> m_hiddenScale;       // Requantisation of the hidden units to [0, 127]
+    std::vector<float> m_hiddenBias;
+    std::vector<int8_t> m_outputWeights;    // classes x m_hiddenStride
+    std::vector<float> m_outputScale;       // int32 sum --> logit
+    std::vector<float> m_outputBias;
+    std::vector<int> m_labels;              // ASCII code per output
+
+    /* ----------------------- Private member functions ----------------------- */
+    static int32_t dot(const uint8_t* inputs, const int8_t* weights, const int stride);
+    // Random affine warp of a raw cell (bilinear, zero border) as network inputs in [0, 1]
+    void augment(const uint8_t* cell, float* inputs, std::mt19937& random) const;
+    void quantise(const std::vector<float>& hiddenWeights, const std::vector<float>& hiddenBias,
+                  const std::vector<float>& outputWeights, const std::vector<float>& outputBias,
+                  const std::vector<float>& inputs, const int count);
+    // Forward pass of one cell, input and hidden are scratch buffers of the padded lengths,
+    // logits one of the number of labels
+    CellPrediction predict(const uint8_t* features, uint8_t* input, uint8_t* hidden, float* logits) const;
+
+public:
+    MlpClassifier(const int hiddenUnits = 128, const int epochs = 60,
+                  const int cellWidth = 20, const int cellHeight = 30);     // Constructor
+    ~MlpClassifier();                                                       // Destructor
+
+    /* ----------------------- Public member functions ----------------------- */
+    bool empty() const override;
+    int dims() const override;
+
+    // DigitClassifier interface (CV_8U samples, CV_32S labels). Training is deterministic,
+    // the confidence is the difference of the softmax probabilities of label and runner-up.
+    bool train(const cv::Mat& samples, const cv::Mat& labels) override;
+    std::vector<CellPrediction> classify(const cv::Mat& samples) const override;
+
+    // The quantised network as model sections (NetworkHiddenWeights ... NetworkOutputParams)
+    bool load(const ModelFile& model) override;
+    ModelPayloads parameters() const override;
+};
+
+#endif // MLPCLASSIFIER_H
@@ -0,0 +1,337 @@
+#include "modelfile.h"
+#include <cstdio>
+#include <cstring>
+#include <climits>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <utility>
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+const char modelMagic[8] = {'S', 'D', 'K', 'M', 'O', 'D', 'E', 'L'};
+
+uint64_t alignUp(const uint64_t value, const uint64_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+// Element depth each section has to be stored with (sections unknown to this version are only bounds checked)
+bool hasKnownDepth(const ModelSection& section)
+{
+    switch(static_cast<ModelSectionType>(section.type))
+    {
+    case ModelSectionType::Labels:
+        return section.elemType == CV_32S;
+    case ModelSectionType::Samples:
+        return section.elemType == CV_8U || section.elemType == CV_32F;
+    case ModelSectionType::NetworkHiddenWeights:
+    case ModelSectionType::NetworkOutputWeights:
+        return section.elemType == CV_8S;
+    case ModelSectionType::ProjectionMean:
+    case ModelSectionType::ProjectionBasis:
+    case ModelSectionType::NetworkHiddenParams:
+    case ModelSectionType::NetworkOutputParams:
+        return section.elemType == CV_32F;
+    }
+    return section.elemType == CV_8U || section.elemType == CV_8S || section.elemType == CV_32S || section.elemType == CV_32F;
+}
+}
+
+const uint32_t ModelFile::m_version;
+const size_t ModelFile::m_alignment;
+
+ModelFile::ModelFile()
+    : m_data(nullptr)
+    , m_size(0)
+    , m_mapping(nullptr)
+    , m_header(nullptr)
+    , m_sections(nullptr)
+{}
+
+ModelFile::~ModelFile()
+{
+    close();
+}
+
+bool ModelFile::open(const std::string& path)
+{
+    close();
+
+#if !defined(_WIN32)
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if(fd < 0)
+        return false;
+
+    struct stat info;
+    if(fstat(fd, &info) != 0 || info.st_size < static_cast<off_t>(sizeof(ModelHeader)))
+    {
+        ::close(fd);
+        return false;
+    }
+
+    void* mapping = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if(mapping != MAP_FAILED)
+    {
+        m_mapping = mapping;
+        m_data = static_cast<const uint8_t*>(mapping);
+        m_size = static_cast<size_t>(info.st_size);
+    }
+#endif
+
+    // No mmap available (or the file cannot be mapped): read the file in one go
+    if(m_data == nullptr)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if(!file)
+            return false;
+        m_buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        m_data = m_buffer.data();
+        m_size = m_buffer.size();
+    }
+
+    m_header = reinterpret_cast<const ModelHeader*>(m_data);
+    m_sections = reinterpret_cast<const ModelSection*>(m_data + sizeof(ModelHeader));
+    if(!validate())
+    {
+        std::cout << "Error: " << path << " is not a valid model file!" << std::endl;
+        close();
+        return false;
+    }
+    return true;
+}
+
+void ModelFile::close()
+{
+#if !defined(_WIN32)
+    if(m_mapping != nullptr)
+        munmap(m_mapping, m_size);
+#endif
+    m_mapping = nullptr;
+    m_buffer.clear();
+    m_data = nullptr;
+    m_size = 0;
+    m_header = nullptr;
+    m_sections = nullptr;
+}
+
+bool ModelFile::isOpen() const
+{
+    return m_data != nullptr;
+}
+
+// Checks magic, version, that all sections lie (aligned) inside the file with the element type
+// of their content, and that the samples fit the cell size. Every size in the file is untrusted:
+// the checks are written so that none of them can overflow.
+bool ModelFile::validate() const
+{
+    if(m_size < sizeof(ModelHeader) || std::memcmp(m_header->magic, modelMagic, sizeof(modelMagic)) != 0)
+        return false;
+    if(m_header->version == 0 || m_header->version > m_version || m_header->fileSize != m_size)
+        return false;
+    if(m_header->sectionCount > (m_size - sizeof(ModelHeader)) / sizeof(ModelSection))
+        return false;
+    if(m_header->cellWidth == 0 || m_header->cellHeight == 0 || m_header->cellWidth > INT_MAX / m_header->cellHeight)
+        return false;
+
+    for(uint32_t i = 0; i < m_header->sectionCount; ++i)
+    {
+        const ModelSection& section = m_sections[i];
+        if(!hasKnownDepth(section) || section.rows == 0 || section.cols == 0 ||
+           section.rows > static_cast<uint32_t>(INT_MAX) || section.cols > static_cast<uint32_t>(INT_MAX))
+            return false;
+
+        const uint64_t rowBytes = static_cast<uint64_t>(section.cols) * CV_ELEM_SIZE1(section.elemType);
+        if(section.offset % m_alignment != 0 || section.step < rowBytes || section.step > m_size)
+            return false;
+        if(section.offset > m_size || section.rows > (m_size - section.offset) / section.step)
+            return false;
+    }
+
+    const ModelSection* samples = findSection(ModelSectionType::Samples);
+    const ModelSection* labels = findSection(ModelSectionType::Labels);
+    if(samples == nullptr || labels == nullptr || samples->rows != labels->rows || labels->cols != 1)
+        return false;
+
+    // Raw pixel models have one sample column per cell pixel. A projection maps the cell pixels
+    // to the sample features: one basis row per feature.
+    const ModelSection* mean = findSection(ModelSectionType::ProjectionMean);
+    const ModelSection* basis = findSection(ModelSectionType::ProjectionBasis);
+    if(mean == nullptr && basis == nullptr)
+        return samples->cols == m_header->cellWidth * m_header->cellHeight;
+    return mean != nullptr && basis != nullptr && mean->rows == 1 && mean->cols == basis->cols && basis->rows == samples->cols;
+}
+
+const ModelSection* ModelFile::findSection(const ModelSectionType type) const
+{
+    for(uint32_t i = 0; i < m_header->sectionCount; ++i)
+    {
+        if(m_sections[i].type == static_cast<uint32_t>(type))
+            return &m_sections[i];
+    }
+    return nullptr;
+}
+
+// Wraps a section in a cv::Mat header without copying the data
+cv::Mat ModelFile::sectionMat(const ModelSectionType type) const
+{
+    if(!isOpen())
+        return cv::Mat();
+
+    const ModelSection* section = findSection(type);
+    if(section == nullptr)
+        return cv::Mat();
+
+    return cv::Mat(static_cast<int>(section->rows), static_cast<int>(section->cols), static_cast<int>(section->elemType),
+                   const_cast<uint8_t*>(m_data + section->offset), static_cast<size_t>(section->step));
+}
+
+cv::Mat ModelFile::samples() const
+{
+    return sectionMat(ModelSectionType::Samples);
+}
+
+cv::Mat ModelFile::labels() const
+{
+    return sectionMat(ModelSectionType::Labels);
+}
+
+cv::Mat ModelFile::projectionMean() const
+{
+    return sectionMat(ModelSectionType::ProjectionMean);
+}
+
+cv::Mat ModelFile::projectionBasis() const
+{
+    return sectionMat(ModelSectionType::ProjectionBasis);
+}
+
+cv::Mat ModelFile::networkHiddenWeights() const
+{
+    return sectionMat(ModelSectionType::NetworkHiddenWeights);
+}
+
+cv::Mat ModelFile::networkHiddenParams() const
+{
+    return sectionMat(ModelSectionType::NetworkHiddenParams);
+}
+
+cv::Mat ModelFile::networkOutputWeights() const
+{
+    return sectionMat(ModelSectionType::NetworkOutputWeights);
+}
+
+cv::Mat ModelFile::networkOutputParams() const
+{
+    return sectionMat(ModelSectionType::NetworkOutputParams);
+}
+
+int ModelFile::cellWidth() const
+{
+    return isOpen() ? static_cast<int>(m_header->cellWidth) : 0;
+}
+
+int ModelFile::cellHeight() const
+{
+    return isOpen() ? static_cast<int>(m_header->cellHeight) : 0;
+}
+
+bool ModelFile::write(const std::string& path, const cv::Mat& samples, const cv::Mat& labels,
+                      const int cellWidth, const int cellHeight,
+                      const cv::Mat& projectionMean, const cv::Mat& projectionBasis,
+                      const ModelPayloads& extraSections)
+{
+    if(samples.empty() || samples.channels() != 1 || (samples.depth() != CV_8U && samples.depth() != CV_32F))
+        return false;
+
+    // Labels may come as float (classificationDigits.xml) or int
+    cv::Mat intLabels;
+    labels.reshape(1, static_cast<int>(labels.total())).convertTo(intLabels, CV_32S);
+    if(intLabels.rows != samples.rows)
+        return false;
+
+    // The projection is optional, but mean and basis only make sense together
+    const bool hasProjection = !projectionMean.empty() || !projectionBasis.empty();
+    if(hasProjection && (projectionMean.type() != CV_32FC1 || projectionBasis.type() != CV_32FC1 ||
+                         projectionMean.rows != 1 || projectionMean.cols != projectionBasis.cols ||
+                         projectionBasis.rows != samples.cols))
+        return false;
+
+    std::vector<std::pair<ModelSectionType, cv::Mat>> payloads;
+    payloads.push_back(std::make_pair(ModelSectionType::Labels, intLabels));
+    payloads.push_back(std::make_pair(ModelSectionType::Samples, samples));
+    if(hasProjection)
+    {
+        payloads.push_back(std::make_pair(ModelSectionType::ProjectionMean, projectionMean));
+        payloads.push_back(std::make_pair(ModelSectionType::ProjectionBasis, projectionBasis));
+    }
+    for(const auto& extra : extraSections)
+    {
+        if(extra.second.empty() || extra.second.channels() != 1)
+            return false;
+        payloads.push_back(extra);
+    }
+
+    std::vector<ModelSection> sections(payloads.size());
+    uint64_t end = sizeof(ModelHeader) + sections.size() * sizeof(ModelSection);
+    for(size_t i = 0; i < payloads.size(); ++i)
+    {
+        const cv::Mat& mat = payloads[i].second;
+        sections[i].type = static_cast<uint32_t>(payloads[i].first);
+        sections[i].elemType = static_cast<uint32_t>(mat.depth());
+        sections[i].rows = static_cast<uint32_t>(mat.rows);
+        sections[i].cols = static_cast<uint32_t>(mat.cols);
+        // Single column sections are stored densely, all others with aligned rows
+        sections[i].step = (mat.cols == 1) ? mat.elemSize() : alignUp(mat.cols * mat.elemSize(), m_alignment);
+        sections[i].offset = alignUp(end, m_alignment);
+        end = sections[i].offset + sections[i].step * sections[i].rows;
+    }
+
+    ModelHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, modelMagic, sizeof(modelMagic));
+    header.version = hasProjection ? m_version : 1;   // Files without projection stay readable by version 1
+    header.sectionCount = static_cast<uint32_t>(sections.size());
+    header.cellWidth = static_cast<uint32_t>(cellWidth);
+    header.cellHeight = static_cast<uint32_t>(cellHeight);
+    header.fileSize = end;
+
+    // Assemble the file in memory (zero padding between the aligned parts)
+    std::vector<uint8_t> bytes(static_cast<size_t>(header.fileSize), 0);
+    std::memcpy(&bytes[0], &header, sizeof(header));
+    std::memcpy(&bytes[sizeof(header)], sections.data(), sections.size() * sizeof(ModelSection));
+    for(size_t i = 0; i < payloads.size(); ++i)
+    {
+        const cv::Mat& mat = payloads[i].second;
+        for(int r = 0; r < mat.rows; ++r)
+            std::memcpy(&bytes[sections[i].offset + r * sections[i].step], mat.ptr(r), mat.cols * mat.elemSize());
+    }
+
+    // Written next to the target and renamed over it: readers (and a running ModelWatcher)
+    // never see a partial file, mappings of the old file stay valid
+    const std::string temporaryPath = path + ".tmp";
+    {
+        std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+        if(!file)
+            return false;
+        file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+        if(!file)
+            return false;
+    }
+#if defined(_WIN32)
+    std::remove(path.c_str());     // rename does not replace existing files on Windows
+#endif
+    if(std::rename(temporaryPath.c_str(), path.c_str()) != 0)
+    {
+        std::remove(temporaryPath.c_str());
+        return false;
+    }
+    return true;
+}
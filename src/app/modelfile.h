@@ -0,0 +1,108 @@
+#ifndef MODELFILE_H
+#define MODELFILE_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+#include <opencv2/core.hpp>
+
+// Binary OCR model that is memory mapped instead of parsed.
+// Layout (little endian):
+//   ModelHeader (64 bytes)
+//   ModelSection table (32 bytes per section)
+//   Section payloads, every payload and every sample row starts 64 byte aligned
+struct ModelHeader
+{
+    char magic[8];          // "SDKMODEL"
+    uint32_t version;
+    uint32_t sectionCount;
+    uint32_t cellWidth;     // Size of the digit images the samples were taken from
+    uint32_t cellHeight;
+    uint64_t fileSize;
+    uint8_t reserved[32];
+};
+
+struct ModelSection
+{
+    uint32_t type;          // ModelSectionType
+    uint32_t elemType;      // OpenCV depth of the elements (CV_8U, CV_8S, CV_32S, CV_32F)
+    uint32_t rows;
+    uint32_t cols;
+    uint64_t offset;        // Start of the payload in the file
+    uint64_t step;          // Bytes per row
+};
+
+enum class ModelSectionType : uint32_t
+{
+    Labels = 1,     // rows x 1 CV_32S, ASCII code of the digit
+    Samples = 2,            // rows x featureLength, one training digit per row
+    ProjectionMean = 3,     // 1 x inputLength CV_32F, mean of the downsampled cells (version 2)
+    ProjectionBasis = 4,    // featureLength x inputLength CV_32F, scaled PCA basis (version 2)
+    // Offline trained classifier parameters (see MlpClassifier). Readers that do not know a
+    // section skip it, so these do not change the version of the file.
+    NetworkHiddenWeights = 5,   // hidden x featureLength CV_8S
+    NetworkHiddenParams = 6,    // 2 x hidden CV_32F: requantisation scale and bias per unit
+    NetworkOutputWeights = 7,   // classes x hidden CV_8S
+    NetworkOutputParams = 8     // 3 x classes CV_32F: scale, bias and ASCII code per class
+};
+
+// Additional sections for ModelFile::write
+typedef std::vector<std::pair<ModelSectionType, cv::Mat>> ModelPayloads;
+
+class ModelFile
+{
+private:
+    // Member variables
+    static const uint32_t m_version = 2;
+    static const size_t m_alignment = 64;
+
+    const uint8_t* m_data;
+    size_t m_size;
+    void* m_mapping;                // Memory mapped file (POSIX)
+    std::vector<uint8_t> m_buffer;  // File contents where it cannot be mapped (Windows, mmap failure)
+    const ModelHeader* m_header;
+    const ModelSection* m_sections;
+
+    /* ----------------------- Private member functions ----------------------- */
+    const ModelSection* findSection(const ModelSectionType type) const;
+    bool validate() const;
+    cv::Mat sectionMat(const ModelSectionType type) const;
+
+public:
+    ModelFile();    // Constructor
+    ~ModelFile();   // Destructor
+    ModelFile(const ModelFile&) = delete;
+    ModelFile& operator=(const ModelFile&) = delete;
+
+    /* ----------------------- Public member functions ----------------------- */
+    // Map the model file into memory (or read it where it cannot be mapped) and check the header
+    // and section table (no parsing of the samples). Corrupt or truncated files are rejected.
+    bool open(const std::string& path);
+    void close();
+    bool isOpen() const;
+
+    // Views into the mapped file (valid as long as the ModelFile is open)
+    cv::Mat samples() const;
+    cv::Mat labels() const;
+    cv::Mat projectionMean() const;     // Empty if the samples are raw pixels
+    cv::Mat projectionBasis() const;
+    cv::Mat networkHiddenWeights() const;   // Empty if the model has no network
+    cv::Mat networkHiddenParams() const;
+    cv::Mat networkOutputWeights() const;
+    cv::Mat networkOutputParams() const;
+    int cellWidth() const;
+    int cellHeight() const;
+
+    // Store samples (CV_8U or CV_32F, one row per digit) and labels (ASCII codes) as binary model,
+    // optionally with the feature projection (see FeatureProjection) the samples were computed with
+    // and further sections such as the parameters of a trained classifier.
+    // An existing file is replaced in one step (written to <path>.tmp and renamed).
+    static bool write(const std::string& path, const cv::Mat& samples, const cv::Mat& labels,
+                      const int cellWidth, const int cellHeight,
+                      const cv::Mat& projectionMean = cv::Mat(), const cv::Mat& projectionBasis = cv::Mat(),
+                      const ModelPayloads& extraSections = ModelPayloads());
+};
+
+#endif // MODELFILE_H
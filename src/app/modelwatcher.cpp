@@ -0,0 +1,153 @@
+#include "modelwatcher.h"
+#include <chrono>
+#include <iostream>
+#if defined(__linux__)
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#else
+#include <sys/stat.h>
+#endif
+
+namespace
+{
+#if defined(__linux__)
+void splitPath(const std::string& path, std::string& directory, std::string& name)
+{
+    const size_t separator = path.find_last_of("/\\");
+    directory = (separator == std::string::npos) ? std::string(".") : path.substr(0, separator + 1);
+    name = (separator == std::string::npos) ? path : path.substr(separator + 1);
+}
+#else
+// Size and modification time, changes if the file is rewritten or replaced
+struct FileStamp
+{
+    long long size;
+    long long modified;
+
+    bool operator!=(const FileStamp& other) const
+    {
+        return size != other.size || modified != other.modified;
+    }
+};
+
+FileStamp fileStamp(const std::string& path)
+{
+    struct stat info;
+    if(stat(path.c_str(), &info) != 0)
+        return FileStamp{-1, -1};
+    return FileStamp{static_cast<long long>(info.st_size), static_cast<long long>(info.st_mtime)};
+}
+#endif
+}
+
+const int ModelWatcher::m_pollInterval;
+const int ModelWatcher::m_settleTime;
+
+ModelWatcher::ModelWatcher()
+    : m_running(false)
+    , m_inotify(-1)
+{}
+
+ModelWatcher::~ModelWatcher()
+{
+    stop();
+}
+
+bool ModelWatcher::start(const std::string& path, const std::function<void()>& onChange)
+{
+    stop();
+    m_path = path;
+    m_onChange = onChange;
+
+#if defined(__linux__)
+    // Watch the directory: writers that rename a new file over the model replace its inode
+    std::string directory;
+    std::string name;
+    splitPath(path, directory, name);
+    m_inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if(m_inotify < 0 || inotify_add_watch(m_inotify, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+    {
+        std::cout << "Error: " << directory << " cannot be watched!" << std::endl;
+        if(m_inotify >= 0)
+            close(m_inotify);
+        m_inotify = -1;
+        return false;
+    }
+#endif
+
+    m_running = true;
+    m_thread = std::thread(&ModelWatcher::run, this);
+    return true;
+}
+
+void ModelWatcher::stop()
+{
+    m_running = false;
+    if(m_thread.joinable())
+        m_thread.join();
+#if defined(__linux__)
+    if(m_inotify >= 0)
+        close(m_inotify);
+#endif
+    m_inotify = -1;
+}
+
+bool ModelWatcher::isRunning() const
+{
+    return m_running;
+}
+
+void ModelWatcher::run()
+{
+#if defined(__linux__)
+    std::string directory;
+    std::string name;
+    splitPath(m_path, directory, name);
+#else
+    FileStamp stamp = fileStamp(m_path);
+#endif
+    bool pending = false;
+    std::chrono::steady_clock::time_point lastChange;
+
+    while(m_running)
+    {
+        bool changed = false;
+#if defined(__linux__)
+        pollfd descriptor = {m_inotify, POLLIN, 0};
+        if(poll(&descriptor, 1, pending ? m_settleTime : m_pollInterval) > 0)
+        {
+            // Events of the other files in the directory are read and dropped
+            alignas(inotify_event) char buffer[4096];
+            ssize_t length;
+            while((length = read(m_inotify, buffer, sizeof(buffer))) > 0)
+            {
+                for(char* entry = buffer; entry < buffer + length; )
+                {
+                    const inotify_event* event = reinterpret_cast<const inotify_event*>(entry);
+                    if(event->len > 0 && name == event->name)
+                        changed = true;
+                    entry += sizeof(inotify_event) + event->len;
+                }
+            }
+        }
+#else
+        std::this_thread::sleep_for(std::chrono::milliseconds(pending ? m_settleTime : m_pollInterval));
+        const FileStamp current = fileStamp(m_path);
+        changed = current != stamp;
+        stamp = current;
+#endif
+
+        const auto now = std::chrono::steady_clock::now();
+        if(changed)
+        {
+            pending = true;
+            lastChange = now;
+        }
+        else if(pending && now - lastChange >= std::chrono::milliseconds(m_settleTime))
+        {
+            pending = false;
+            m_onChange();
+        }
+    }
+}
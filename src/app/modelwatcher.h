@@ -0,0 +1,42 @@
+#ifndef MODELWATCHER_H
+#define MODELWATCHER_H
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+
+// Watches one file from a background thread and calls onChange once the file was rewritten
+// or replaced (e.g. renamed over). On Linux the directory of the file is watched with inotify,
+// elsewhere size and modification time are polled. Bursts of events are merged: the callback
+// runs on the watcher thread after the file has been quiet for m_settleTime.
+class ModelWatcher
+{
+private:
+    // Member variables
+    static const int m_pollInterval = 200;  // ms, also the reaction time of stop()
+    static const int m_settleTime = 100;    // ms without further changes before onChange runs
+
+    std::string m_path;
+    std::function<void()> m_onChange;
+    std::atomic<bool> m_running;
+    std::thread m_thread;
+    int m_inotify;                          // inotify instance (Linux), -1 otherwise
+
+    /* ----------------------- Private member functions ----------------------- */
+    void run();
+
+public:
+    ModelWatcher();     // Constructor
+    ~ModelWatcher();    // Destructor
+    ModelWatcher(const ModelWatcher&) = delete;
+    ModelWatcher& operator=(const ModelWatcher&) = delete;
+
+    /* ----------------------- Public member functions ----------------------- */
+    // Start watching path (a running watch is stopped first)
+    bool start(const std::string& path, const std::function<void()>& onChange);
+    void stop();
+    bool isRunning() const;
+};
+
+#endif // MODELWATCHER_H
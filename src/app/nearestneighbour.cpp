@@ -0,0 +1,376 @@
+#include "nearestneighbour.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <map>
+#if defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#endif
+
+namespace
+{
+// Relative slack of the triangle inequality bounds: the square roots are rounded, a sample
+// is only skipped if its lower bound is clearly above the search bound
+const double boundTolerance = 1e-9;
+
+// True if every sample at least gap (euclidean) away is farther than the squared distance bound
+bool beyond(const double gap, const uint32_t bound)
+{
+    return gap > 0.0 && gap * gap > static_cast<double>(bound) * (1.0 + boundTolerance) + boundTolerance;
+}
+
+// Largest distance that rounds to a float no larger than bound (floats hold integers exactly up
+// to 2^24, above that one rounding step is at most bound >> 22). Searches use it as their bound,
+// a sample that ties with the best one as a float must not be skipped.
+uint32_t tieBound(const uint32_t bound)
+{
+    if(bound < (1u << 24))
+        return bound;
+    return static_cast<uint32_t>(std::min<uint64_t>(static_cast<uint64_t>(bound) + (bound >> 22), std::numeric_limits<uint32_t>::max()));
+}
+
+// Nearest sample so far and the nearest one of another label, with the training index for ties
+struct Candidate
+{
+    int label;
+    uint32_t distance;
+    int index;
+
+    // Smaller distance, on equal distances the earlier training sample. Like cv::ml::KNearest the
+    // distances are compared rounded to float, which keeps the first of equally near samples.
+    bool isBeatenBy(const uint32_t otherDistance, const int otherIndex) const
+    {
+        const float other = static_cast<float>(otherDistance);
+        const float own = static_cast<float>(distance);
+        return other < own || (other == own && otherIndex < index);
+    }
+};
+}
+
+const int NearestNeighbour::m_abandonStep;
+
+NearestNeighbour::NearestNeighbour()
+    : m_dims(0)
+    , m_stride(0)
+    , m_count(0)
+{}
+
+NearestNeighbour::~NearestNeighbour(){}
+
+// Sum of squared differences of two zero padded vectors (stride is a multiple of 32)
+uint32_t NearestNeighbour::squaredDistance(const uint8_t* a, const uint8_t* b, const int stride)
+{
+#if defined(__AVX2__)
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i sum = _mm256_setzero_si256();
+    for(int i = 0; i < stride; i += 32)
+    {
+        const __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        const __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+
+        // |a - b| with saturating subtraction, widened to 16 bit and squared + pairwise added
+        const __m256i diff = _mm256_or_si256(_mm256_subs_epu8(va, vb), _mm256_subs_epu8(vb, va));
+        const __m256i low = _mm256_unpacklo_epi8(diff, zero);
+        const __m256i high = _mm256_unpackhi_epi8(diff, zero);
+        sum = _mm256_add_epi32(sum, _mm256_madd_epi16(low, low));
+        sum = _mm256_add_epi32(sum, _mm256_madd_epi16(high, high));
+    }
+    __m128i total = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    total = _mm_add_epi32(total, _mm_shuffle_epi32(total, _MM_SHUFFLE(1, 0, 3, 2)));
+    total = _mm_add_epi32(total, _mm_shuffle_epi32(total, _MM_SHUFFLE(2, 3, 0, 1)));
+    return static_cast<uint32_t>(_mm_cvtsi128_si32(total));
+#elif defined(__SSE2__) || defined(_M_X64)
+    const __m128i zero = _mm_setzero_si128();
+    __m128i sum = _mm_setzero_si128();
+    for(int i = 0; i < stride; i += 16)
+    {
+        const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+        const __m128i diff = _mm_or_si128(_mm_subs_epu8(va, vb), _mm_subs_epu8(vb, va));
+        const __m128i low = _mm_unpacklo_epi8(diff, zero);
+        const __m128i high = _mm_unpackhi_epi8(diff, zero);
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(low, low));
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(high, high));
+    }
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+    return static_cast<uint32_t>(_mm_cvtsi128_si32(sum));
+#else
+    uint32_t sum = 0;
+    for(int i = 0; i < stride; ++i)
+    {
+        const int diff = static_cast<int>(a[i]) - static_cast<int>(b[i]);
+        sum += static_cast<uint32_t>(diff * diff);
+    }
+    return sum;
+#endif
+}
+
+// squaredDistance that stops once the partial sum exceeds bound (every m_abandonStep bytes)
+uint32_t NearestNeighbour::boundedDistance(const uint8_t* a, const uint8_t* b, const int stride, const uint32_t bound)
+{
+#if defined(__AVX2__)
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i sum = _mm256_setzero_si256();
+    for(int start = 0; start < stride; start += m_abandonStep)
+    {
+        const int end = std::min(start + m_abandonStep, stride);
+        for(int i = start; i < end; i += 32)
+        {
+            const __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+            const __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+            const __m256i diff = _mm256_or_si256(_mm256_subs_epu8(va, vb), _mm256_subs_epu8(vb, va));
+            const __m256i low = _mm256_unpacklo_epi8(diff, zero);
+            const __m256i high = _mm256_unpackhi_epi8(diff, zero);
+            sum = _mm256_add_epi32(sum, _mm256_madd_epi16(low, low));
+            sum = _mm256_add_epi32(sum, _mm256_madd_epi16(high, high));
+        }
+        __m128i total = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+        total = _mm_add_epi32(total, _mm_shuffle_epi32(total, _MM_SHUFFLE(1, 0, 3, 2)));
+        total = _mm_add_epi32(total, _mm_shuffle_epi32(total, _MM_SHUFFLE(2, 3, 0, 1)));
+        const uint32_t partial = static_cast<uint32_t>(_mm_cvtsi128_si32(total));
+        if(partial > bound || end == stride)
+            return partial;
+    }
+    return 0;
+#elif defined(__SSE2__) || defined(_M_X64)
+    const __m128i zero = _mm_setzero_si128();
+    __m128i sum = _mm_setzero_si128();
+    for(int start = 0; start < stride; start += m_abandonStep)
+    {
+        const int end = std::min(start + m_abandonStep, stride);
+        for(int i = start; i < end; i += 16)
+        {
+            const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+            const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+            const __m128i diff = _mm_or_si128(_mm_subs_epu8(va, vb), _mm_subs_epu8(vb, va));
+            const __m128i low = _mm_unpacklo_epi8(diff, zero);
+            const __m128i high = _mm_unpackhi_epi8(diff, zero);
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(low, low));
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(high, high));
+        }
+        __m128i total = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+        total = _mm_add_epi32(total, _mm_shuffle_epi32(total, _MM_SHUFFLE(2, 3, 0, 1)));
+        const uint32_t partial = static_cast<uint32_t>(_mm_cvtsi128_si32(total));
+        if(partial > bound || end == stride)
+            return partial;
+    }
+    return 0;
+#else
+    uint32_t sum = 0;
+    for(int start = 0; start < stride; start += m_abandonStep)
+    {
+        const int end = std::min(start + m_abandonStep, stride);
+        for(int i = start; i < end; ++i)
+        {
+            const int diff = static_cast<int>(a[i]) - static_cast<int>(b[i]);
+            sum += static_cast<uint32_t>(diff * diff);
+        }
+        if(sum > bound)
+            return sum;
+    }
+    return sum;
+#endif
+}
+
+void NearestNeighbour::train(const uint8_t* samples, const size_t sampleStep, const int count, const int dims, const int* labels)
+{
+    m_dims = dims;
+    m_stride = (dims + 31) / 32 * 32;
+    m_count = count;
+
+    // Dimensions with the largest variance first: they add the most to the distance of a wrong sample
+    std::vector<double> sums(dims, 0.0);
+    std::vector<double> squares(dims, 0.0);
+    for(int i = 0; i < count; ++i)
+    {
+        const uint8_t* sample = samples + i * sampleStep;
+        for(int d = 0; d < dims; ++d)
+        {
+            sums[d] += sample[d];
+            squares[d] += static_cast<double>(sample[d]) * sample[d];
+        }
+    }
+    m_order.resize(dims);
+    for(int d = 0; d < dims; ++d)
+        m_order[d] = d;
+    std::stable_sort(m_order.begin(), m_order.end(), [&](const int x, const int y)
+    {
+        return squares[x] - sums[x] * sums[x] / count > squares[y] - sums[y] * sums[y] / count;
+    });
+
+    // Group the samples by label (in training order within a label)
+    std::map<int, std::vector<int>> members;
+    for(int i = 0; i < count; ++i)
+        members[labels[i]].push_back(i);
+
+    m_samples.assign(static_cast<size_t>(count) * m_stride, 0);
+    m_indices.resize(count);
+    m_radii.resize(count);
+    m_classes.clear();
+    m_centres.assign(members.size() * m_stride, 0);
+
+    int stored = 0;
+    for(const auto& member : members)
+    {
+        // Rounded mean of the class, any point works for the triangle inequality
+        uint8_t* centre = &m_centres[m_classes.size() * m_stride];
+        for(int d = 0; d < dims; ++d)
+        {
+            double sum = 0.0;
+            for(const int i : member.second)
+                sum += samples[i * sampleStep + m_order[d]];
+            centre[d] = static_cast<uint8_t>(std::lround(sum / member.second.size()));
+        }
+
+        std::vector<std::pair<double, int>> byRadius;
+        std::vector<uint8_t> permuted(m_stride, 0);
+        for(const int i : member.second)
+        {
+            for(int d = 0; d < dims; ++d)
+                permuted[d] = samples[i * sampleStep + m_order[d]];
+            byRadius.push_back(std::make_pair(std::sqrt(static_cast<double>(squaredDistance(permuted.data(), centre, m_stride))), i));
+        }
+        std::sort(byRadius.begin(), byRadius.end());
+
+        const LabelClass labelClass = {member.first, stored, stored + static_cast<int>(byRadius.size()),
+                                       byRadius.front().first, byRadius.back().first};
+        for(const std::pair<double, int>& entry : byRadius)
+        {
+            uint8_t* sample = &m_samples[static_cast<size_t>(stored) * m_stride];
+            for(int d = 0; d < dims; ++d)
+                sample[d] = samples[entry.second * sampleStep + m_order[d]];
+            m_indices[stored] = entry.second;
+            m_radii[stored] = entry.first;
+            ++stored;
+        }
+        m_classes.push_back(labelClass);
+    }
+}
+
+bool NearestNeighbour::train(const cv::Mat& samples, const cv::Mat& labels)
+{
+    if(samples.empty() || samples.type() != CV_8UC1 || labels.type() != CV_32SC1 || labels.total() != static_cast<size_t>(samples.rows))
+        return false;
+
+    const cv::Mat continuousLabels = labels.isContinuous() ? labels : labels.clone();
+    train(samples.ptr(), samples.step, samples.rows, samples.cols, continuousLabels.ptr<int>());
+    return true;
+}
+
+std::vector<CellPrediction> NearestNeighbour::classify(const cv::Mat& samples) const
+{
+    std::vector<CellPrediction> predictions;
+    if(empty() || samples.type() != CV_8UC1 || samples.cols != m_dims)
+        return predictions;
+
+    std::vector<NeighbourMatch> matches(samples.rows);
+    findNearest(samples.ptr(), samples.step, samples.rows, matches.data());
+
+    // Confidence on the euclidean distances
+    predictions.reserve(matches.size());
+    for(const NeighbourMatch& match : matches)
+        predictions.push_back(CellPrediction{char(match.label), char(match.runnerUp),
+                                             distanceConfidence(std::sqrt(static_cast<float>(match.distance)),
+                                                                std::sqrt(static_cast<float>(match.runnerUpDistance)),
+                                                                match.runnerUp != 0)});
+    return predictions;
+}
+
+bool NearestNeighbour::empty() const
+{
+    return m_count == 0;
+}
+
+int NearestNeighbour::dims() const
+{
+    return m_dims;
+}
+
+int NearestNeighbour::count() const
+{
+    return m_count;
+}
+
+void NearestNeighbour::findNearest(const uint8_t* queries, const size_t queryStep, const int queryCount, int* labels) const
+{
+    std::vector<NeighbourMatch> matches(queryCount > 0 ? queryCount : 0);
+    search(queries, queryStep, queryCount, matches.data(), false);
+    for(int q = 0; q < queryCount; ++q)
+        labels[q] = matches[q].label;
+}
+
+void NearestNeighbour::findNearest(const uint8_t* queries, const size_t queryStep, const int queryCount, NeighbourMatch* matches) const
+{
+    search(queries, queryStep, queryCount, matches, true);
+}
+
+void NearestNeighbour::search(const uint8_t* queries, const size_t queryStep, const int queryCount, NeighbourMatch* matches, const bool runnerUps) const
+{
+    if(queryCount <= 0)
+        return;
+
+    const uint32_t maxDistance = std::numeric_limits<uint32_t>::max();
+    const int classCount = static_cast<int>(m_classes.size());
+    std::vector<uint8_t> query(m_stride, 0);
+    std::vector<double> centreDistances(classCount);
+    std::vector<int> visits(classCount);
+
+    for(int q = 0; q < queryCount; ++q)
+    {
+        // Zero padded copy of the query in the stored dimension order
+        const uint8_t* source = queries + q * queryStep;
+        for(int d = 0; d < m_dims; ++d)
+            query[d] = source[m_order[d]];
+
+        // Classes with the nearest centre first, they set a small runner-up distance early
+        for(int c = 0; c < classCount; ++c)
+        {
+            centreDistances[c] = std::sqrt(static_cast<double>(squaredDistance(query.data(), &m_centres[static_cast<size_t>(c) * m_stride], m_stride)));
+            visits[c] = c;
+        }
+        std::sort(visits.begin(), visits.end(), [&](const int x, const int y) { return centreDistances[x] < centreDistances[y]; });
+
+        // Invariant: best is the nearest sample seen, runnerUp the nearest one with another label. A sample
+        // farther than runnerUp changes neither (farther than best changes no label), and neither does a
+        // sample farther than an earlier one of its class. Anything beyond that bound is skipped or abandoned.
+        Candidate best = {0, maxDistance, std::numeric_limits<int>::max()};
+        Candidate runnerUp = {0, maxDistance, std::numeric_limits<int>::max()};
+        for(const int c : visits)
+        {
+            const LabelClass& labelClass = m_classes[c];
+            const double centreDistance = centreDistances[c];
+            uint32_t bound = tieBound(runnerUps ? runnerUp.distance : best.distance);
+            if(beyond(labelClass.minRadius - centreDistance, bound) || beyond(centreDistance - labelClass.maxRadius, bound))
+                continue;
+
+            for(int i = labelClass.first; i < labelClass.last; ++i)
+            {
+                // |d(query, centre) - d(sample, centre)| <= d(query, sample), the radii are ascending
+                const double gap = m_radii[i] - centreDistance;
+                if(beyond(gap, bound))
+                    break;
+                if(beyond(-gap, bound))
+                    continue;
+
+                const uint32_t distance = boundedDistance(query.data(), &m_samples[static_cast<size_t>(i) * m_stride], m_stride, bound);
+                if(distance > bound)
+                    continue;
+
+                const int index = m_indices[i];
+                if(best.isBeatenBy(distance, index))
+                {
+                    // The old best is the nearest sample of any other label than the new one
+                    if(labelClass.label != best.label)
+                        runnerUp = best;
+                    best = Candidate{labelClass.label, distance, index};
+                }
+                else if(labelClass.label != best.label && runnerUp.isBeatenBy(distance, index))
+                    runnerUp = Candidate{labelClass.label, distance, index};
+                bound = tieBound(std::min(distance, runnerUps ? runnerUp.distance : best.distance));
+            }
+        }
+        matches[q] = NeighbourMatch{best.label, runnerUp.label, best.distance, runnerUp.distance};
+    }
+}
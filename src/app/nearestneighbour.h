@@ -0,0 +1,91 @@
+#ifndef NEARESTNEIGHBOUR_H
+#define NEARESTNEIGHBOUR_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "digitclassifier.h"
+
+// Result of a nearest neighbour query: the nearest training sample and the nearest
+// sample with a different label (runnerUp = 0 if all training samples share one label)
+struct NeighbourMatch
+{
+    int label;
+    int runnerUp;
+    uint32_t distance;
+    uint32_t runnerUpDistance;
+};
+
+// Exact 1-nearest-neighbour search on uint8 feature vectors (binarised cell pixels).
+// Distances are exact integer sums of squared differences, computed 32 (AVX2) or 16 (SSE2)
+// bytes at a time on samples zero padded to a multiple of 32 bytes. Most samples are never
+// fully compared:
+// - the dimensions are stored in order of decreasing variance, so partial distances grow fast
+//   and are abandoned once they exceed the runner-up distance or the nearest sample of the
+//   same class so far (such a sample changes nothing)
+// - every label class has a centre, the triangle inequality on the distances to it bounds
+//   whole classes and single samples from below, classes are visited nearest centre first
+// The results (labels, runner-up and distances) are the same as those of the full scan.
+class NearestNeighbour : public DigitClassifier
+{
+private:
+    // Samples of one label, stored consecutively and sorted by their distance to the centre
+    struct LabelClass
+    {
+        int label;
+        int first;
+        int last;
+        double minRadius;
+        double maxRadius;
+    };
+
+    // Member variables
+    static const int m_abandonStep = 128;   // Bytes between two checks of a partial distance
+
+    int m_dims;                         // Feature length
+    int m_stride;                       // Padded feature length
+    int m_count;                        // Number of training samples
+    std::vector<int> m_order;           // Stored dimension -> feature dimension (decreasing variance)
+    std::vector<uint8_t> m_samples;     // m_count x m_stride, dimensions in m_order, grouped by class
+    std::vector<int> m_indices;         // Training index per stored sample (ties go to the earlier one)
+    std::vector<double> m_radii;        // Euclidean distance of each stored sample to its class centre
+    std::vector<LabelClass> m_classes;
+    std::vector<uint8_t> m_centres;     // Rounded class means, m_classes.size() x m_stride
+
+    /* ----------------------- Private member functions ----------------------- */
+    static uint32_t squaredDistance(const uint8_t* a, const uint8_t* b, const int stride);
+
+    // Exact distance if it is at most bound, otherwise any value above bound
+    static uint32_t boundedDistance(const uint8_t* a, const uint8_t* b, const int stride, const uint32_t bound);
+
+    // Both findNearest, without runnerUps only the labels are exact (and samples are pruned against the best)
+    void search(const uint8_t* queries, const size_t queryStep, const int queryCount, NeighbourMatch* matches, const bool runnerUps) const;
+
+public:
+    NearestNeighbour();     // Constructor
+    ~NearestNeighbour();    // Destructor
+
+    /* ----------------------- Public member functions ----------------------- */
+    // Copy the training samples (count rows of dims bytes, sampleStep bytes apart) and their labels
+    void train(const uint8_t* samples, const size_t sampleStep, const int count, const int dims, const int* labels);
+
+    bool empty() const override;
+    int dims() const override;
+    int count() const;
+
+    // DigitClassifier interface (CV_8U samples, CV_32S labels)
+    bool train(const cv::Mat& samples, const cv::Mat& labels) override;
+    std::vector<CellPrediction> classify(const cv::Mat& samples) const override;
+
+    // Label of the nearest training sample for every query row. Tie rule of cv::ml::KNearest
+    // (k = 1): distances are compared rounded to float and on equal distances the sample with the
+    // smaller training index wins, so of duplicate samples with different labels the first one
+    // decides. OCRBench checks the labels against KNearest.
+    // Without the runner-up the samples are pruned against the nearest one, several times faster.
+    void findNearest(const uint8_t* queries, const size_t queryStep, const int queryCount, int* labels) const;
+
+    // Same search, also keeps the runner-up label and both distances (tracked in the same pass)
+    void findNearest(const uint8_t* queries, const size_t queryStep, const int queryCount, NeighbourMatch* matches) const;
+};
+
+#endif // NEARESTNEIGHBOUR_H
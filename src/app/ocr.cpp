@@ -1,8 +1,22 @@
 #include "ocr.h"
+#include <cstdlib>
+#include <fstream>
 
-OCR::OCR(){}
+OCR::OCR()
+{
+    const char* modelPath = std::getenv("SUDOKUOCR_MODEL");
+    if(modelPath != nullptr && modelPath[0] != '\0')
+        m_modelPath = modelPath;
+    const char* classifier = std::getenv("SUDOKUOCR_CLASSIFIER");
+    if(classifier != nullptr && classifier[0] != '\0')
+        m_classifierName = classifier;
+}
 
-OCR::~OCR(){}
+OCR::~OCR()
+{
+    // The watcher thread reloads into this object
+    m_watcher.stop();
+}
 
 void OCR::getBoundingRect(cv::Mat trainingImage, cv::Mat thresholdImage, std::vector<std::vector<cv::Point>> cVector)
 {
@@ -79,6 +93,11 @@ void OCR::writeTrainedImageFile()
 
 bool OCR::checkIfFilesExists()
 {
+    // A binary model replaces the two xml files
+    ModelFile modelFile;
+    if(modelFile.open(modelPath()))
+        return true;
+
     // Try to open the trained and classification image file
     cv::FileStorage fs_class(filename_class, cv::FileStorage::READ);
     cv::FileStorage fs_trained(filename_trained, cv::FileStorage::READ);
@@ -102,25 +121,16 @@ bool OCR::checkIfFilesExists()
     }
 }
 
-std::string OCR::train(std::vector<cv::Mat> labelTrain)
+// Reads the classification digits and training images from the xml files
+bool OCR::readTrainingFiles(cv::Mat& classificationImg, cv::Mat& trainingImg) const
 {
-
-    // The classification data is read from the stored file
-    // Once the classification and image files are created,
-    // we do not need to create it everytime we run the program.
-    // Therefore, we only read the files in future runs
-    cv::Mat classificationImg;
-    cv::Mat trainingImg;
-
     cv::FileStorage fs_class(filename_class, cv::FileStorage::READ);
 
-    // Make sure the file exists, otherwise exit
+    // Make sure the file exists
     if(!fs_class.isOpened())
     {
         std::cout << "Error: Classification file not found!" << std::endl;
-        // Exit failure: abnormal termination of the program ...
-        // return 0 does not work since the function expects a vector of ints
-        exit(1);
+        return false;
     }
 
     // Write the file content into the class member image
@@ -129,13 +139,11 @@ std::string OCR::train(std::vector<cv::Mat> labelTrain)
 
     cv::FileStorage fs_images(filename_trained, cv::FileStorage::READ);
 
-    // Make sure the file exists, otherwise exit
+    // Make sure the file exists
     if(!fs_images.isOpened())
     {
         std::cout << "Error: training images file not found!" << std::endl;
-        // Exit failure: abnormal termination of the program ...
-        // return 0 does not work since the function expects a vector of ints
-        exit(1);
+        return false;
     }
 
     // Write the file content into the class member image
@@ -143,53 +151,364 @@ std::string OCR::train(std::vector<cv::Mat> labelTrain)
     fs_images.release();
 
     std::cout << "files opened and read in..." << std::endl;
+    return true;
+}
+
+std::shared_ptr<const OCRModel> OCR::readModel(const std::string& modelPath, const std::string& classifierName) const
+{
+    std::unique_ptr<DigitClassifier> classifier = ClassifierRegistry::create(classifierName);
+    if(!classifier)
+    {
+        std::cout << "Error: Unknown classifier " << classifierName << ", available:";
+        for(const std::string& available : ClassifierRegistry::names())
+            std::cout << " " << available;
+        std::cout << std::endl;
+        return nullptr;
+    }
+
+    std::shared_ptr<OCRModel> model = std::make_shared<OCRModel>();
+    model->classifierName = classifierName;
+    cv::Mat classificationImg;
+    cv::Mat trainingImg;
+    bool loaded = false;
+
+    // Prefer the binary model: it is mapped into memory instead of being parsed
+    ModelFile modelFile;
+    if(modelFile.open(modelPath))
+    {
+        if(modelFile.cellWidth() != m_cellWidth || modelFile.cellHeight() != m_cellHeight)
+        {
+            std::cout << "Error: Model cells are " << modelFile.cellWidth() << "x" << modelFile.cellHeight()
+                      << ", expected " << m_cellWidth << "x" << m_cellHeight << "!" << std::endl;
+            return nullptr;
+        }
+        classificationImg = modelFile.labels();
+        trainingImg = modelFile.samples();
+        model->source = modelPath;
+        std::cout << "binary model mapped..." << std::endl;
+
+        // Models with a projection store the compact features instead of the pixels
+        const cv::Mat mean = modelFile.projectionMean();
+        if(!mean.empty() && !model->projection.load(mean, modelFile.projectionBasis(), m_cellWidth, m_cellHeight))
+        {
+            std::cout << "Error: Feature projection of the model does not match the cell size!" << std::endl;
+            return nullptr;
+        }
+        if(!model->projection.empty() && !ClassifierRegistry::acceptsProjectedFeatures(classifierName))
+        {
+            std::cout << "Error: Classifier " << classifierName << " needs the cell pixels, the model only has projected features!" << std::endl;
+            return nullptr;
+        }
+
+        // Offline trained parameters of the model take precedence over training on the samples
+        loaded = classifier->load(modelFile);
+    }
+    else if(std::ifstream(modelPath).good())
+    {
+        // A model file that is corrupt or half written is rejected, a reload keeps the current model
+        std::cout << "Error: " << modelPath << " cannot be used as model!" << std::endl;
+        return nullptr;
+    }
+    else if(!readTrainingFiles(classificationImg, trainingImg))
+        return nullptr;
+    else
+        model->source = filename_trained;
+
+    // The classifiers work on uint8 pixels (the training images are 0-255 anyway) and int labels.
+    // convertTo copies the data, so nothing refers to the mapped file once it is closed.
+    cv::Mat byteSamples;
+    cv::Mat intLabels;
+    trainingImg.convertTo(byteSamples, CV_8U);
+    classificationImg.reshape(1, static_cast<int>(classificationImg.total())).convertTo(intLabels, CV_32S);
+
+    const int featureLength = model->projection.empty() ? m_cellWidth * m_cellHeight : model->projection.components();
+    if(byteSamples.rows != intLabels.rows || byteSamples.rows == 0 || byteSamples.cols != featureLength)
+    {
+        std::cout << "Error: Training images and classification digits do not match!" << std::endl;
+        return nullptr;
+    }
 
-    // Training the KNearestNeighbor
-    cv::Ptr<cv::ml::KNearest> knearest = cv::ml::KNearest::create();
+    if(!loaded && !classifier->train(byteSamples, intLabels))
+    {
+        std::cout << "Error: Classifier " << classifierName << " could not be trained!" << std::endl;
+        return nullptr;
+    }
 
-    std::cout << "KNearest created...";
+    // The model has to take the features it is going to get
+    if(classifier->empty() || classifier->dims() != featureLength || classifier->classify(byteSamples.rowRange(0, 1)).size() != 1)
+    {
+        std::cout << "Error: Classifier " << classifierName << " does not match the model features!" << std::endl;
+        return nullptr;
+    }
 
-    // Set properties of KNearest
-    knearest->setIsClassifier(true);
-    knearest->setAlgorithmType(cv::ml::KNearest::Types::BRUTE_FORCE);
-    knearest->setDefaultK(1);
+    model->classifier = std::move(classifier);
+    model->cache.reset(new CellCache(m_cellWidth * m_cellHeight));
+    return model;
+}
 
-    // Checks the matrix shape (rows, cols)
-    // std::cout << "TrainingImage Dimension: (" << trainingImg.rows << "," <<
-    //              trainingImg.cols << ")" << std::endl;
-    // std::cout << "ClassificationDigits Dimension: (" << classificationImg.rows << "," <<
-    //              classificationImg.cols << ")" << std::endl;
+bool OCR::loadModel()
+{
+    // The model is read only once, afterwards the trained classifier is kept
+    // in memory for all following images (until the next reload)
+    std::lock_guard<std::mutex> lock(m_loadMutex);
+    const std::shared_ptr<const OCRModel> model = readModel(m_modelPath, m_classifierName);
+    if(!model)
+        return false;
 
-    // Train the knn algorithm
-    knearest->train(trainingImg, cv::ml::ROW_SAMPLE, classificationImg);
+    std::atomic_store(&m_model, model);
+    std::cout << "OCR model loaded (" << model->classifierName << ", " << model->source << ")..." << std::endl;
+    return true;
+}
 
-    // Store the trained model
-    knearest->save("../SudokuOCR/src/knn.yml");
+bool OCR::isModelLoaded() const
+{
+    const std::shared_ptr<const OCRModel> current = model();
+    return current && current->classifier && !current->classifier->empty();
+}
 
-    // This string holds the resulting numbers
-    std::string detectedDigits;
+std::shared_ptr<const OCRModel> OCR::model() const
+{
+    return std::atomic_load(&m_model);
+}
 
-    // Find the knearest neighbour for every image of the sudoku cells
-    std::for_each(labelTrain.begin(), labelTrain.end(), [&](cv::Mat cImg)
+bool OCR::setClassifier(const std::string& name)
+{
+    std::lock_guard<std::mutex> lock(m_loadMutex);
+    if(model())
+    {
+        const std::shared_ptr<const OCRModel> rebuilt = readModel(m_modelPath, name);
+        if(!rebuilt)
+            return false;
+        std::atomic_store(&m_model, rebuilt);
+    }
+    else if(!ClassifierRegistry::create(name))
     {
-        // Prepare training image to be compatible with knearest
-        // 1.) Convert to float
-        cv::Mat floatCellImage;
-        cImg.convertTo(floatCellImage, CV_32FC1);
+        std::cout << "Error: Unknown classifier " << name << "!" << std::endl;
+        return false;
+    }
+
+    m_classifierName = name;
+    return true;
+}
 
-        // 2.) Reshape or flatten respectively
-        cv::Mat flattenedCellImage;
-        flattenedCellImage = floatCellImage.reshape(1, 1);
+std::string OCR::classifierName() const
+{
+    std::lock_guard<std::mutex> lock(m_loadMutex);
+    return m_classifierName;
+}
 
-        // Evaluate the digit by calling kNearest
-        cv::Mat knnResult;
-        float digit = knearest->findNearest(flattenedCellImage, knearest->getDefaultK(), knnResult);
+void OCR::setModelPath(const std::string& path)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_loadMutex);
+        m_modelPath = path;
+    }
+    if(m_watcher.isRunning())
+        watchModel(true);
+}
+
+std::string OCR::modelPath() const
+{
+    std::lock_guard<std::mutex> lock(m_loadMutex);
+    return m_modelPath;
+}
+
+bool OCR::watchModel(const bool enable)
+{
+    if(!enable)
+    {
+        m_watcher.stop();
+        return true;
+    }
 
-        // Convert float to string
-        detectedDigits += char(int(digit));
+    // The reload runs on the watcher thread, classifications keep using the old model meanwhile
+    return m_watcher.start(modelPath(), [this]()
+    {
+        std::cout << "Model file changed, reloading..." << std::endl;
+        if(!loadModel())
+        {
+            std::cout << "Error: Reload failed, keeping the current model!" << std::endl;
+            ++m_failedReloads;
+        }
+        ++m_reloadAttempts;
     });
+}
+
+int OCR::reloadAttempts() const
+{
+    return m_reloadAttempts;
+}
+
+int OCR::failedReloads() const
+{
+    return m_failedReloads;
+}
+
+std::string OCR::predict(const std::vector<cv::Mat>& cellImages) const
+{
+    std::string detectedDigits = toDigits(predictCells(cellImages));
 
     // Return a string of the detected images
     std::cout << "The detected digits are: " << detectedDigits << std::endl;
     return detectedDigits;
 }
+
+std::vector<CellPrediction> OCR::predictCells(const std::vector<cv::Mat>& cellImages) const
+{
+    // Features and classification from the same model, even if a reload happens meanwhile
+    const std::shared_ptr<const OCRModel> current = model();
+    if(!current)
+    {
+        std::cout << "Error: OCR model not loaded!" << std::endl;
+        return std::vector<CellPrediction>();
+    }
+    return classifyCells(*current, makePixelBatch(cellImages));
+}
+
+CellCache::Statistics OCR::cacheStatistics() const
+{
+    const std::shared_ptr<const OCRModel> current = model();
+    if(!current || !current->cache)
+        return CellCache::Statistics{0, 0};
+    return current->cache->statistics();
+}
+
+cv::Mat OCR::makeBatch(const std::vector<cv::Mat>& cellImages) const
+{
+    const std::shared_ptr<const OCRModel> current = model();
+    return current ? makeBatch(*current, cellImages) : makeBatch(OCRModel(), cellImages);
+}
+
+cv::Mat OCR::makeBatch(const OCRModel& model, const std::vector<cv::Mat>& cellImages) const
+{
+    const cv::Mat samples = makePixelBatch(cellImages);
+    if(!model.projection.empty())
+        return model.projection.project(samples);
+    return samples;
+}
+
+cv::Mat OCR::makePixelBatch(const std::vector<cv::Mat>& cellImages) const
+{
+    // Allocate the whole batch once, every cell is converted directly into its row
+    const int featureLength = m_cellWidth * m_cellHeight;
+    cv::Mat samples(static_cast<int>(cellImages.size()), featureLength, CV_8UC1);
+
+    for(size_t i = 0; i < cellImages.size(); ++i)
+    {
+        cv::Mat cellImage = cellImages[i];
+        if(cellImage.cols != m_cellWidth || cellImage.rows != m_cellHeight)
+            cv::resize(cellImages[i], cellImage, cv::Size(m_cellWidth, m_cellHeight));
+        cv::Mat sampleRow = samples.row(static_cast<int>(i));
+
+        // A row of any other length would make convertTo reallocate instead of filling the batch row
+        if(cellImage.channels() == 3 || cellImage.channels() == 4)
+            cv::cvtColor(cellImage, cellImage, (cellImage.channels() == 3) ? cv::COLOR_RGB2GRAY : cv::COLOR_RGBA2GRAY);
+        else if(cellImage.channels() != 1)
+        {
+            std::cout << "Error: Cell image with " << cellImage.channels() << " channels cannot be classified!" << std::endl;
+            sampleRow.setTo(cv::Scalar(0));
+            continue;
+        }
+        if(!cellImage.isContinuous())
+            cellImage = cellImage.clone();
+
+        cellImage.reshape(1, 1).convertTo(sampleRow, CV_8UC1);
+    }
+    return samples;
+}
+
+std::vector<CellPrediction> OCR::classifyCells(const OCRModel& model, const cv::Mat& pixels) const
+{
+    if(!model.cache)
+        return classifyBatch(model, model.projection.empty() ? pixels : model.projection.project(pixels));
+
+    // Answer the repeated cells from the cache, only the others go through the classifier
+    CellCache& cache = *model.cache;
+    const int keyWords = cache.keyWords();
+    std::vector<uint64_t> keys(static_cast<size_t>(pixels.rows) * keyWords);
+    std::vector<CellPrediction> predictions(pixels.rows);
+    std::vector<int> missed;
+
+    for(int i = 0; i < pixels.rows; ++i)
+    {
+        uint64_t* key = &keys[static_cast<size_t>(i) * keyWords];
+        cache.pack(pixels.ptr<uint8_t>(i), key);
+        if(!cache.lookup(key, predictions[i]))
+            missed.push_back(i);
+    }
+    if(missed.empty())
+        return predictions;
+
+    cv::Mat missedPixels = pixels;
+    if(static_cast<int>(missed.size()) != pixels.rows)
+    {
+        missedPixels = cv::Mat(static_cast<int>(missed.size()), pixels.cols, pixels.type());
+        for(size_t m = 0; m < missed.size(); ++m)
+        {
+            cv::Mat missedRow = missedPixels.row(static_cast<int>(m));
+            pixels.row(missed[m]).copyTo(missedRow);
+        }
+    }
+
+    const std::vector<CellPrediction> classified =
+        classifyBatch(model, model.projection.empty() ? missedPixels : model.projection.project(missedPixels));
+    if(classified.size() != missed.size())
+        return classified;
+
+    for(size_t m = 0; m < missed.size(); ++m)
+    {
+        const int i = missed[m];
+        predictions[i] = classified[m];
+        cache.insert(&keys[static_cast<size_t>(i) * keyWords], classified[m]);
+    }
+    return predictions;
+}
+
+std::string OCR::predictBatch(const cv::Mat& samples) const
+{
+    return toDigits(classifyBatch(samples));
+}
+
+std::vector<CellPrediction> OCR::classifyBatch(const cv::Mat& samples) const
+{
+    const std::shared_ptr<const OCRModel> current = model();
+    if(!current)
+    {
+        std::cout << "Error: OCR model not loaded!" << std::endl;
+        return std::vector<CellPrediction>();
+    }
+    return classifyBatch(*current, samples);
+}
+
+std::vector<CellPrediction> OCR::classifyBatch(const OCRModel& model, const cv::Mat& samples) const
+{
+    std::vector<CellPrediction> predictions;
+    if(!model.classifier || model.classifier->empty())
+    {
+        std::cout << "Error: OCR model not loaded!" << std::endl;
+        return predictions;
+    }
+    if(samples.empty())
+        return predictions;
+
+    // All classifiers expect uint8 rows of the trained feature length
+    cv::Mat byteSamples = samples;
+    if(samples.depth() != CV_8U)
+        samples.convertTo(byteSamples, CV_8U);
+    if(byteSamples.cols != model.classifier->dims())
+    {
+        std::cout << "Error: Sample length does not match the OCR model!" << std::endl;
+        return predictions;
+    }
+
+    // One call for all cells, the runner-up is found in the same pass
+    return model.classifier->classify(byteSamples);
+}
+
+std::string OCR::toDigits(const std::vector<CellPrediction>& predictions)
+{
+    std::string digits;
+    for(const CellPrediction& prediction : predictions)
+        digits += prediction.label;
+    return digits;
+}
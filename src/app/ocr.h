@@ -2,7 +2,25 @@
 #define OCR_H
 
 #include "imageprocessing.h"
-#include <opencv2/ml.hpp>
+#include "modelfile.h"
+#include "digitclassifier.h"
+#include "featureprojection.h"
+#include "modelwatcher.h"
+#include "cellcache.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+// Everything a classification needs. A loaded model is never modified: a reload builds a new
+// one and swaps the pointer, classifications that are running keep the old model alive.
+struct OCRModel
+{
+    std::shared_ptr<const DigitClassifier> classifier;
+    FeatureProjection projection;   // Feature stage of the model, empty for raw pixel models
+    std::string classifierName;     // Registry name (see ClassifierRegistry)
+    std::string source;             // File the model was read from
+    std::unique_ptr<CellCache> cache;   // Classifications of this model by cell bitmap (a reload starts empty)
+};
 
 class OCR
 {
@@ -10,6 +28,13 @@ private:
     // Member variables
     cv::Mat m_classificationInputDigits;
     cv::Mat m_trainingImageOutput;
+    std::shared_ptr<const OCRModel> m_model;        // Only accessed with std::atomic_load / std::atomic_store
+    std::string m_classifierName = "knn";           // Classifier of the next (re)load
+    std::string m_modelPath = "../SudokuOCR/src/digitModel.bin";      // Binary model (preferred)
+    mutable std::mutex m_loadMutex;                 // Serialises loads, guards m_classifierName and m_modelPath
+    ModelWatcher m_watcher;
+    std::atomic<int> m_reloadAttempts{0};           // Reloads finished by the watcher, successful or not
+    std::atomic<int> m_failedReloads{0};
     const std::string filename_class = "../SudokuOCR/src/classificationDigits.xml";
     const std::string filename_trained = "../SudokuOCR/src/trainedImages.xml";
     const int m_cellWidth = 20;
@@ -17,6 +42,17 @@ private:
     const int m_maxContourArea = 1000;
     const int m_minContourArea = 60;
 
+    /* ----------------------- Private member functions ----------------------- */
+    bool readTrainingFiles(cv::Mat& classificationImg, cv::Mat& trainingImg) const;
+
+    // Read and validate a complete model (nullptr on failure), called with m_loadMutex held
+    std::shared_ptr<const OCRModel> readModel(const std::string& modelPath, const std::string& classifierName) const;
+
+    cv::Mat makePixelBatch(const std::vector<cv::Mat>& cellImages) const;
+    cv::Mat makeBatch(const OCRModel& model, const std::vector<cv::Mat>& cellImages) const;
+    std::vector<CellPrediction> classifyCells(const OCRModel& model, const cv::Mat& pixels) const;
+    std::vector<CellPrediction> classifyBatch(const OCRModel& model, const cv::Mat& samples) const;
+
 public:
     OCR(); // Constructor
     ~OCR(); // Destructor
@@ -30,8 +66,57 @@ public:
 
     bool checkIfFilesExists();
 
-    // Train the KNN algorithm and return a string with the detected digits
-    std::string train(std::vector<cv::Mat> labelTrain);
+    // Read the binary model (or the classification and training files) and train the classifier.
+    // The environment variable SUDOKUOCR_CLASSIFIER overrides the classifier name. Safe to call
+    // while other threads classify: the new model is swapped in once it is complete and valid,
+    // on failure the current model stays.
+    bool loadModel();
+
+    bool isModelLoaded() const;
+
+    // The current model (nullptr if none is loaded), stays valid while it is held
+    std::shared_ptr<const OCRModel> model() const;
+
+    // Select the classifier by registry name ("knn", "hamming", "template", "mlp", ...). Parameters
+    // stored in the binary model are used if present, otherwise the classifier is trained on the
+    // samples. A loaded model is rebuilt right away, the old model stays on failure.
+    bool setClassifier(const std::string& name);
+    std::string classifierName() const;
+
+    // Path of the binary model, the environment variable SUDOKUOCR_MODEL overrides the default.
+    // Takes effect with the next loadModel (and restarts a running watch).
+    void setModelPath(const std::string& path);
+    std::string modelPath() const;
+
+    // Reload the model in the background whenever the binary model file is rewritten or replaced
+    bool watchModel(const bool enable);
+
+    // Number of reloads the watcher has finished, and how many of them kept the current model
+    int reloadAttempts() const;
+    int failedReloads() const;
+
+    // Classify the cell images with the loaded model and return a string with the detected digits
+    std::string predict(const std::vector<cv::Mat>& cellImages) const;
+
+    // Classify the cell images with label, runner-up and confidence per cell. Binarised cells
+    // that were classified before by the current model are answered from its cell cache.
+    std::vector<CellPrediction> predictCells(const std::vector<cv::Mat>& cellImages) const;
+
+    // Hits and misses of the cell cache of the current model (zero if none is loaded)
+    CellCache::Statistics cacheStatistics() const;
+
+    // Flatten the cell images into one sample matrix (one row per cell, projected to the
+    // model features if the model has a projection), batches of several images can be
+    // stacked with push_back and classified together. predict and predictCells use one model
+    // for both steps, a reload between makeBatch and classifyBatch may change the features.
+    cv::Mat makeBatch(const std::vector<cv::Mat>& cellImages) const;
+
+    // Classify all rows of a sample matrix with a single call to the model
+    std::string predictBatch(const cv::Mat& samples) const;
+    std::vector<CellPrediction> classifyBatch(const cv::Mat& samples) const;
+
+    // String of the best labels
+    static std::string toDigits(const std::vector<CellPrediction>& predictions);
 };
 
 #endif // OCR_H
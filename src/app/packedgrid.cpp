@@ -0,0 +1,166 @@
+#include "packedgrid.h"
+#include <algorithm>
+#include <cstring>
+
+const int PackedGrid::m_cells;
+const int PackedGrid::m_bytes;
+
+PackedGrid::PackedGrid()
+{
+    m_data.fill(0);
+}
+
+PackedGrid::PackedGrid(const std::vector<int>& puzzle)
+{
+    pack(puzzle);
+}
+
+PackedGrid::PackedGrid(const uint8_t* bytes)
+{
+    std::memcpy(m_data.data(), bytes, m_bytes);
+}
+
+void PackedGrid::pack(const std::vector<int>& puzzle)
+{
+    m_data.fill(0);
+    const int cells = std::min(static_cast<int>(puzzle.size()), m_cells);
+    for(int cell = 0; cell < cells; ++cell)
+        m_data[cell >> 1] |= static_cast<uint8_t>((puzzle[cell] & 0xF) << ((cell & 1) * 4));
+}
+
+void PackedGrid::unpack(std::vector<int>& puzzle) const
+{
+    puzzle.resize(m_cells);
+
+    // Two cells per byte, the last byte only holds cell 80
+    for(int i = 0; i < m_bytes - 1; ++i)
+    {
+        puzzle[2 * i] = m_data[i] & 0xF;
+        puzzle[2 * i + 1] = m_data[i] >> 4;
+    }
+    puzzle[m_cells - 1] = m_data[m_bytes - 1] & 0xF;
+}
+
+std::vector<int> PackedGrid::unpack() const
+{
+    std::vector<int> puzzle;
+    unpack(puzzle);
+    return puzzle;
+}
+
+int PackedGrid::get(const int cell) const
+{
+    return (m_data[cell >> 1] >> ((cell & 1) * 4)) & 0xF;
+}
+
+void PackedGrid::set(const int cell, const int digit)
+{
+    const int shift = (cell & 1) * 4;
+    uint8_t& byte = m_data[cell >> 1];
+    byte = static_cast<uint8_t>((byte & ~(0xF << shift)) | ((digit & 0xF) << shift));
+}
+
+const uint8_t* PackedGrid::data() const
+{
+    return m_data.data();
+}
+
+bool PackedGrid::operator==(const PackedGrid& other) const
+{
+    return m_data == other.m_data;
+}
+
+bool PackedGrid::operator!=(const PackedGrid& other) const
+{
+    return m_data != other.m_data;
+}
+
+PackedGridArray::PackedGridArray(){}
+
+PackedGridArray::~PackedGridArray(){}
+
+void PackedGridArray::reserve(const size_t count)
+{
+    m_data.reserve(count * PackedGrid::m_bytes);
+}
+
+size_t PackedGridArray::size() const
+{
+    return m_data.size() / PackedGrid::m_bytes;
+}
+
+bool PackedGridArray::empty() const
+{
+    return m_data.empty();
+}
+
+void PackedGridArray::clear()
+{
+    m_data.clear();
+}
+
+void PackedGridArray::push_back(const std::vector<int>& puzzle)
+{
+    push_back(PackedGrid(puzzle));
+}
+
+void PackedGridArray::push_back(const PackedGrid& grid)
+{
+    m_data.insert(m_data.end(), grid.data(), grid.data() + PackedGrid::m_bytes);
+}
+
+PackedGrid PackedGridArray::operator[](const size_t index) const
+{
+    return PackedGrid(grid(index));
+}
+
+void PackedGridArray::unpack(const size_t index, std::vector<int>& puzzle) const
+{
+    PackedGrid(grid(index)).unpack(puzzle);
+}
+
+const uint8_t* PackedGridArray::grid(const size_t index) const
+{
+    return m_data.data() + index * PackedGrid::m_bytes;
+}
+
+const uint8_t* PackedGridArray::data() const
+{
+    return m_data.data();
+}
+
+size_t PackedGridArray::removeDuplicates()
+{
+    const size_t count = size();
+    const int bytes = PackedGrid::m_bytes;
+
+    // Sort indices by grid content so equal grids become neighbours
+    std::vector<uint32_t> order(count);
+    for(size_t i = 0; i < count; ++i)
+        order[i] = static_cast<uint32_t>(i);
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b)
+    {
+        return std::memcmp(grid(a), grid(b), bytes) < 0;
+    });
+
+    // Mark every grid that equals its sorted predecessor (stable sort keeps the first one)
+    std::vector<bool> duplicate(count, false);
+    for(size_t i = 1; i < count; ++i)
+    {
+        if(std::memcmp(grid(order[i - 1]), grid(order[i]), bytes) == 0)
+            duplicate[order[i]] = true;
+    }
+
+    // Compact in place, the original order is kept
+    size_t kept = 0;
+    for(size_t i = 0; i < count; ++i)
+    {
+        if(duplicate[i])
+            continue;
+        if(kept != i)
+            std::memmove(&m_data[kept * bytes], &m_data[i * bytes], bytes);
+        ++kept;
+    }
+    m_data.resize(kept * bytes);
+    return count - kept;
+}
@@ -0,0 +1,70 @@
+#ifndef PACKEDGRID_H
+#define PACKEDGRID_H
+
+#include <vector>
+#include <array>
+#include <cstdint>
+#include <cstddef>
+
+// Compact 9x9 sudoku: 81 cells x 4 bit = 41 bytes (even cells in the low nibble).
+// Used to hold large puzzle corpora in memory instead of std::vector<int> (324 bytes + heap header).
+class PackedGrid
+{
+public:
+    static const int m_cells = 81;
+    static const int m_bytes = 41;
+
+private:
+    // Member variables
+    std::array<uint8_t, m_bytes> m_data;
+
+public:
+    PackedGrid();                                       // Constructor (empty grid)
+    explicit PackedGrid(const std::vector<int>& puzzle);
+    explicit PackedGrid(const uint8_t* bytes);
+
+    /* ----------------------- Public member functions ----------------------- */
+    void pack(const std::vector<int>& puzzle);
+    void unpack(std::vector<int>& puzzle) const;
+    std::vector<int> unpack() const;
+
+    int get(const int cell) const;
+    void set(const int cell, const int digit);
+
+    const uint8_t* data() const;
+    bool operator==(const PackedGrid& other) const;
+    bool operator!=(const PackedGrid& other) const;
+};
+
+// Contiguous array of packed grids (41 bytes per grid, no per-grid allocation)
+class PackedGridArray
+{
+private:
+    // Member variables
+    std::vector<uint8_t> m_data;
+
+public:
+    PackedGridArray();  // Constructor
+    ~PackedGridArray(); // Destructor
+
+    /* ----------------------- Public member functions ----------------------- */
+    void reserve(const size_t count);
+    size_t size() const;
+    bool empty() const;
+    void clear();
+
+    void push_back(const std::vector<int>& puzzle);
+    void push_back(const PackedGrid& grid);
+
+    PackedGrid operator[](const size_t index) const;
+    void unpack(const size_t index, std::vector<int>& puzzle) const;
+
+    // Raw bytes of one grid (m_bytes long) and of the whole array
+    const uint8_t* grid(const size_t index) const;
+    const uint8_t* data() const;
+
+    // Removes repeated grids (keeps the first occurrence), returns the number of removed grids
+    size_t removeDuplicates();
+};
+
+#endif // PACKEDGRID_H
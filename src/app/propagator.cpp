@@ -0,0 +1,624 @@
+#include "propagator.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+Propagator::Propagator(const int boxSize)
+    : m_boxSize(boxSize)
+    , m_N(boxSize * boxSize)
+    , m_cells(m_N * m_N)
+    , m_allDigits(m_N >= 32 ? 0xFFFFFFFFu : ((1u << m_N) - 1u))
+    , m_cancel(nullptr)
+{
+    // Rows occupy the units [0, N), columns [N, 2N) and boxes [2N, 3N)
+    m_units.resize(3 * m_N);
+    m_cellUnits.resize(m_cells);
+    for(int row = 0; row < m_N; ++row)
+    {
+        for(int col = 0; col < m_N; ++col)
+        {
+            const int cell = row * m_N + col;
+            const int box = (row / m_boxSize) * m_boxSize + col / m_boxSize;
+            m_units[row].push_back(cell);
+            m_units[m_N + col].push_back(cell);
+            m_units[2 * m_N + box].push_back(cell);
+            m_cellUnits[cell] = {row, m_N + col, 2 * m_N + box};
+        }
+    }
+
+    // Collect the peers of every cell (each peer only once)
+    m_peers.resize(m_cells);
+    std::vector<bool> isPeer(m_cells, false);
+    for(int cell = 0; cell < m_cells; ++cell)
+    {
+        for(const int unit : m_cellUnits[cell])
+        {
+            for(const int other : m_units[unit])
+            {
+                if(other != cell && !isPeer[other])
+                {
+                    isPeer[other] = true;
+                    m_peers[cell].push_back(other);
+                }
+            }
+        }
+        for(const int other : m_peers[cell])
+            isPeer[other] = false;
+    }
+}
+
+Propagator::~Propagator(){}
+
+// Removes a digit from the candidates of a cell and propagates the consequences
+bool Propagator::eliminate(std::vector<uint32_t>& candidates, const int cell, const int digit) const
+{
+    const uint32_t bit = 1u << (digit - 1);
+    if(!(candidates[cell] & bit))
+        return true;
+
+    candidates[cell] &= ~bit;
+    const uint32_t remaining = candidates[cell];
+
+    // Contradiction: no digit left for this cell
+    if(remaining == 0)
+        return false;
+
+    // 1) Naked single: the last digit of the cell is removed from all peers
+    if(popCount(remaining) == 1)
+    {
+        const int lastDigit = lowestBitIndex(remaining) + 1;
+        for(const int peer : m_peers[cell])
+        {
+            if(!eliminate(candidates, peer, lastDigit))
+                return false;
+        }
+    }
+
+    // 2) Hidden single: a unit with only one place left for the digit gets it assigned
+    for(const int unit : m_cellUnits[cell])
+    {
+        int places = 0;
+        int place = -1;
+        for(const int other : m_units[unit])
+        {
+            if(candidates[other] & bit)
+            {
+                ++places;
+                place = other;
+            }
+        }
+
+        if(places == 0)
+            return false;
+        if(places == 1 && !assign(candidates, place, digit))
+            return false;
+    }
+    return true;
+}
+
+// Keeps only the given digit in a cell by eliminating all other candidates
+bool Propagator::assign(std::vector<uint32_t>& candidates, const int cell, const int digit) const
+{
+    uint32_t others = candidates[cell] & ~(1u << (digit - 1));
+    while(others)
+    {
+        const int other = lowestBitIndex(others) + 1;
+        others &= others - 1;
+        if(!eliminate(candidates, cell, other))
+            return false;
+    }
+    return (candidates[cell] & (1u << (digit - 1))) != 0;
+}
+
+// Depth first search branching on the cell with the fewest candidates
+// nodes (optional) is the remaining budget, it is negative afterwards if the search ran out of it
+int Propagator::search(std::vector<uint32_t>& candidates, const int limit, std::vector<uint32_t>* solution,
+                       long* nodes) const
+{
+    if(cancelled() || (nodes != nullptr && --*nodes < 0))
+        return 0;
+
+    // Minimum remaining values: pick the undecided cell with the fewest candidates
+    int bestCell = -1;
+    int bestCount = m_N + 1;
+    for(int cell = 0; cell < m_cells; ++cell)
+    {
+        const int count = popCount(candidates[cell]);
+        if(count > 1 && count < bestCount)
+        {
+            bestCell = cell;
+            bestCount = count;
+            if(count == 2)
+                break;
+        }
+    }
+
+    // Every cell holds a single digit --> solved
+    if(bestCell < 0)
+    {
+        if(solution != nullptr && solution->empty())
+            *solution = candidates;
+        return 1;
+    }
+
+    int found = 0;
+    uint32_t digits = candidates[bestCell];
+    while(digits && found < limit)
+    {
+        const int digit = lowestBitIndex(digits) + 1;
+        digits &= digits - 1;
+
+        std::vector<uint32_t> trial(candidates);
+        if(assign(trial, bestCell, digit))
+            found += search(trial, limit - found, solution, nodes);
+    }
+    return found;
+}
+
+bool Propagator::cancelled() const
+{
+    return m_cancel != nullptr && m_cancel->load(std::memory_order_relaxed);
+}
+
+bool Propagator::load(const std::vector<int>& puzzle, std::vector<uint32_t>& candidates) const
+{
+    candidates.assign(m_cells, m_allDigits);
+    if(static_cast<int>(puzzle.size()) != m_cells)
+        return false;
+
+    for(int cell = 0; cell < m_cells; ++cell)
+    {
+        const int digit = puzzle[cell];
+        if(digit == m_EMPTY)
+            continue;
+        if(digit < 0 || digit > m_N || !assign(candidates, cell, digit))
+            return false;
+    }
+    return true;
+}
+
+bool Propagator::solve(std::vector<int>& puzzle) const
+{
+    std::vector<uint32_t> candidates;
+    if(!load(puzzle, candidates))
+        return false;
+
+    std::vector<uint32_t> solution;
+    if(search(candidates, 1, &solution) == 0)
+        return false;
+
+    // Write the digits of the solved candidate masks back to the puzzle
+    for(int cell = 0; cell < m_cells; ++cell)
+        puzzle[cell] = lowestBitIndex(solution[cell]) + 1;
+    return true;
+}
+
+int Propagator::countSolutions(const std::vector<int>& puzzle, const int limit) const
+{
+    std::vector<uint32_t> candidates;
+    if(!load(puzzle, candidates))
+        return 0;
+    return search(candidates, limit, nullptr);
+}
+
+int Propagator::boundedSolvable(const std::vector<int>& puzzle, long& nodes) const
+{
+    std::vector<uint32_t> candidates;
+    if(!load(puzzle, candidates))
+        return 0;
+
+    const int solutions = search(candidates, 1, nullptr, &nodes);
+    const bool exhausted = nodes < 0;
+    nodes = std::max(0L, nodes);
+    if(solutions > 0)
+        return 1;
+    return (exhausted || cancelled()) ? -1 : 0;
+}
+
+// Deletion filter: every given whose removal keeps the puzzle unsolvable is dropped,
+// the remaining givens are each necessary for the contradiction
+std::vector<int> Propagator::conflictCore(const std::vector<int>& puzzle) const
+{
+    std::vector<int> core;
+    if(static_cast<int>(puzzle.size()) != m_cells)
+        return core;
+
+    // A solvable puzzle has no conflict (and without a proof there is no core either)
+    long pool = m_corePoolNodes;
+    if(boundedSolvable(puzzle, pool) != 0)
+        return core;
+
+    // Two equal givens in one unit are the smallest possible core
+    for(int cell = 0; cell < m_cells; ++cell)
+    {
+        if(puzzle[cell] == m_EMPTY)
+            continue;
+        for(const int peer : m_peers[cell])
+        {
+            if(puzzle[peer] == puzzle[cell])
+            {
+                core.push_back(cell);
+                core.push_back(peer);
+                return core;
+            }
+        }
+    }
+
+    std::vector<int> undecided;
+    for(int cell = 0; cell < m_cells; ++cell)
+    {
+        if(puzzle[cell] != m_EMPTY)
+            undecided.push_back(cell);
+    }
+
+    // A given that is necessary stays necessary when other givens are removed, so only the trials
+    // that ran out of budget are repeated, on the meanwhile smaller core with twice the budget.
+    // The retries draw their nodes from the pool, once it is used up the undecided givens stay.
+    std::vector<int> trial(puzzle);
+    for(long budget = m_coreTrialNodes; !undecided.empty(); budget *= 2)
+    {
+        const bool retry = budget > m_coreTrialNodes;
+        if((retry && pool == 0) || cancelled())
+            break;
+
+        std::vector<int> timedOut;
+        for(const int cell : undecided)
+        {
+            long nodes = retry ? std::min(budget, pool) : budget;
+            const long granted = nodes;
+            const int digit = trial[cell];
+            trial[cell] = m_EMPTY;
+            const int solvable = (nodes > 0) ? boundedSolvable(trial, nodes) : -1;
+            if(retry)
+                pool -= granted - nodes;
+            if(solvable == 0)
+                continue;
+
+            trial[cell] = digit;
+            if(solvable < 0)
+                timedOut.push_back(cell);
+        }
+        undecided.swap(timedOut);
+    }
+
+    for(int cell = 0; cell < m_cells; ++cell)
+    {
+        if(trial[cell] != m_EMPTY)
+            core.push_back(cell);
+    }
+    return core;
+}
+
+// Candidates from the givens only (no propagation), so every deduction is still to be found
+bool Propagator::basicCandidates(const std::vector<int>& puzzle, std::vector<uint32_t>& candidates) const
+{
+    candidates.assign(m_cells, m_allDigits);
+    if(static_cast<int>(puzzle.size()) != m_cells)
+        return false;
+
+    for(int cell = 0; cell < m_cells; ++cell)
+    {
+        const int digit = puzzle[cell];
+        if(digit == m_EMPTY)
+            continue;
+        if(digit < 0 || digit > m_N || !(candidates[cell] & (1u << (digit - 1))))
+            return false;
+
+        candidates[cell] = 1u << (digit - 1);
+        for(const int peer : m_peers[cell])
+            candidates[peer] &= ~(1u << (digit - 1));
+    }
+    return true;
+}
+
+// Looks for a naked single first, then hidden singles in boxes, rows and columns
+bool Propagator::findSingle(const std::vector<int>& puzzle, const std::vector<uint32_t>& candidates, Hint& hint) const
+{
+    for(int cell = 0; cell < m_cells; ++cell)
+    {
+        if(puzzle[cell] == m_EMPTY && popCount(candidates[cell]) == 1)
+        {
+            hint.cell = cell;
+            hint.digit = lowestBitIndex(candidates[cell]) + 1;
+            hint.technique = HintTechnique::NakedSingle;
+            return true;
+        }
+    }
+
+    // Units are stored as rows, columns, boxes --> visit boxes first
+    const int unitOrder[3] = {2, 0, 1};
+    const HintTechnique techniques[3] = {HintTechnique::HiddenSingleBox, HintTechnique::HiddenSingleRow, HintTechnique::HiddenSingleColumn};
+    for(int k = 0; k < 3; ++k)
+    {
+        for(int u = unitOrder[k] * m_N; u < (unitOrder[k] + 1) * m_N; ++u)
+        {
+            // Digits that appear exactly once among the open cells of the unit
+            uint32_t once = 0;
+            uint32_t several = 0;
+            uint32_t placed = 0;
+            for(const int cell : m_units[u])
+            {
+                if(puzzle[cell] != m_EMPTY)
+                {
+                    placed |= candidates[cell];
+                    continue;
+                }
+                several |= once & candidates[cell];
+                once |= candidates[cell];
+            }
+
+            const uint32_t singles = once & ~several & ~placed;
+            if(singles == 0)
+                continue;
+
+            const uint32_t bit = singles & (~singles + 1);
+            for(const int cell : m_units[u])
+            {
+                if(puzzle[cell] == m_EMPTY && (candidates[cell] & bit))
+                {
+                    hint.cell = cell;
+                    hint.digit = lowestBitIndex(bit) + 1;
+                    hint.technique = techniques[k];
+                    return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+// Pointing (box --> line) and claiming (line --> box) eliminations, true if anything was removed
+bool Propagator::eliminateLockedCandidates(const std::vector<int>& puzzle, std::vector<uint32_t>& candidates) const
+{
+    bool removed = false;
+    for(int box = 2 * m_N; box < 3 * m_N; ++box)
+    {
+        for(int line = 0; line < 2 * m_N; ++line)
+        {
+            // Digits of the intersection and of the rest of the box and the line
+            uint32_t inside = 0;
+            uint32_t boxRest = 0;
+            uint32_t lineRest = 0;
+            for(const int cell : m_units[box])
+            {
+                if(puzzle[cell] != m_EMPTY)
+                    continue;
+                if(m_cellUnits[cell][line < m_N ? 0 : 1] == line)
+                    inside |= candidates[cell];
+                else
+                    boxRest |= candidates[cell];
+            }
+            if(inside == 0)
+                continue;
+            for(const int cell : m_units[line])
+            {
+                if(puzzle[cell] == m_EMPTY && m_cellUnits[cell][2] != box)
+                    lineRest |= candidates[cell];
+            }
+
+            // Pointing: digit only in the intersection within the box --> remove from the line
+            // Claiming: digit only in the intersection within the line --> remove from the box
+            const uint32_t pointing = inside & ~boxRest & lineRest;
+            const uint32_t claiming = inside & ~lineRest & boxRest;
+            if(pointing)
+            {
+                for(const int cell : m_units[line])
+                {
+                    if(puzzle[cell] == m_EMPTY && m_cellUnits[cell][2] != box)
+                        candidates[cell] &= ~pointing;
+                }
+                removed = true;
+            }
+            if(claiming)
+            {
+                for(const int cell : m_units[box])
+                {
+                    if(puzzle[cell] == m_EMPTY && m_cellUnits[cell][line < m_N ? 0 : 1] != line)
+                        candidates[cell] &= ~claiming;
+                }
+                removed = true;
+            }
+        }
+    }
+    return removed;
+}
+
+bool Propagator::nextHint(const std::vector<int>& puzzle, Hint& hint) const
+{
+    std::vector<uint32_t> candidates;
+    if(!basicCandidates(puzzle, candidates))
+        return false;
+
+    // An open cell without candidates means the grid already contains a mistake
+    for(int cell = 0; cell < m_cells; ++cell)
+    {
+        if(candidates[cell] == 0)
+            return false;
+    }
+
+    if(findSingle(puzzle, candidates, hint))
+        return true;
+
+    // Locked candidates only narrow the candidates, the hint is the single they reveal
+    while(eliminateLockedCandidates(puzzle, candidates))
+    {
+        if(findSingle(puzzle, candidates, hint))
+        {
+            hint.technique = HintTechnique::LockedCandidates;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Divide and conquer over the clues: the candidates passed in already contain every clue outside
+// [first, last). Each half is tested on a state that got the other half assigned, so a clue trial
+// reuses the propagation of all other clues instead of loading the puzzle from scratch.
+void Propagator::findRedundantClues(const std::vector<uint32_t>& candidates, const std::vector<int>& clues, const int first, const int last,
+                                    const std::vector<int>& solution, std::vector<int>& redundantClues) const
+{
+    if(last - first == 1)
+    {
+        // Without this clue the puzzle keeps its unique solution exactly when no solution with a
+        // different digit in the cell exists (a second solution always differs there)
+        const int cell = clues[first];
+        std::vector<uint32_t> trial(candidates);
+        if(!eliminate(trial, cell, solution[cell]) || search(trial, 1, nullptr) == 0)
+            redundantClues.push_back(cell);
+        return;
+    }
+
+    const int mid = first + (last - first) / 2;
+    std::vector<uint32_t> half(candidates);
+    bool consistent = true;
+    for(int k = mid; k < last && consistent; ++k)
+        consistent = assign(half, clues[k], solution[clues[k]]);
+    if(consistent)
+        findRedundantClues(half, clues, first, mid, solution, redundantClues);
+
+    half = candidates;
+    consistent = true;
+    for(int k = first; k < mid && consistent; ++k)
+        consistent = assign(half, clues[k], solution[clues[k]]);
+    if(consistent)
+        findRedundantClues(half, clues, mid, last, solution, redundantClues);
+}
+
+bool Propagator::isMinimal(const std::vector<int>& puzzle, std::vector<int>* redundantClues) const
+{
+    std::vector<int> redundant;
+    if(redundantClues != nullptr)
+        redundantClues->clear();
+
+    // Minimality is only defined for puzzles with exactly one solution (count stops at 2)
+    std::vector<uint32_t> candidates;
+    std::vector<uint32_t> solved;
+    if(!load(puzzle, candidates) || search(candidates, 2, &solved) != 1)
+        return false;
+
+    std::vector<int> solution(m_cells);
+    for(int cell = 0; cell < m_cells; ++cell)
+        solution[cell] = lowestBitIndex(solved[cell]) + 1;
+
+    std::vector<int> clues;
+    for(int cell = 0; cell < m_cells; ++cell)
+    {
+        if(puzzle[cell] != m_EMPTY)
+            clues.push_back(cell);
+    }
+    if(clues.empty())
+        return true;
+
+    const std::vector<uint32_t> empty(m_cells, m_allDigits);
+    findRedundantClues(empty, clues, 0, static_cast<int>(clues.size()), solution, redundant);
+
+    std::sort(redundant.begin(), redundant.end());
+    if(redundantClues != nullptr)
+        *redundantClues = redundant;
+    return redundant.empty();
+}
+
+void Propagator::searchUncertain(const std::vector<uint32_t>& candidates, const std::vector<UncertainGiven>& givens,
+                                 const std::vector<std::vector<float>>& costs, const size_t index, const float cost,
+                                 float& bestCost, std::vector<uint32_t>& best, long& nodes) const
+{
+    // Bound: a more expensive reading than the best solved one cannot win
+    if(cost >= bestCost || ++nodes > m_maxUncertainNodes || cancelled())
+        return;
+
+    // All uncertain givens are committed --> the blank cells decide if this reading is consistent
+    if(index == givens.size())
+    {
+        std::vector<uint32_t> trial(candidates);
+        std::vector<uint32_t> solution;
+        if(search(trial, 1, &solution) > 0)
+        {
+            bestCost = cost;
+            best = solution;
+        }
+        return;
+    }
+
+    const UncertainGiven& given = givens[index];
+    for(size_t i = 0; i < given.digits.size(); ++i)
+    {
+        const int digit = given.digits[i];
+        if(digit < 1 || digit > m_N || !(candidates[given.cell] & (1u << (digit - 1))))
+            continue;
+
+        std::vector<uint32_t> trial(candidates);
+        if(assign(trial, given.cell, digit))
+            searchUncertain(trial, givens, costs, index + 1, cost + costs[index][i], bestCost, best, nodes);
+    }
+}
+
+bool Propagator::solveUncertain(std::vector<int>& puzzle, const std::vector<UncertainGiven>& givens) const
+{
+    if(static_cast<int>(puzzle.size()) != m_cells)
+        return false;
+
+    // Only the certain givens are loaded, the uncertain cells start blank
+    std::vector<int> certain(puzzle);
+    for(const UncertainGiven& given : givens)
+    {
+        if(given.cell < 0 || given.cell >= m_cells || given.digits.empty() || given.digits.size() != given.probabilities.size())
+            return false;
+        certain[given.cell] = m_EMPTY;
+    }
+
+    std::vector<uint32_t> candidates;
+    if(!load(certain, candidates))
+        return false;
+
+    // Every uncertain cell may only take one of its readings
+    for(const UncertainGiven& given : givens)
+    {
+        uint32_t allowed = 0;
+        for(const int digit : given.digits)
+            if(digit >= 1 && digit <= m_N)
+                allowed |= 1u << (digit - 1);
+
+        uint32_t removed = candidates[given.cell] & ~allowed;
+        while(removed)
+        {
+            const int digit = lowestBitIndex(removed) + 1;
+            removed &= removed - 1;
+            if(!eliminate(candidates, given.cell, digit))
+                return false;
+        }
+    }
+
+    // Most confident givens first: their top reading is tried (and fails) first, so the search
+    // spends its alternatives on the doubtful cells
+    std::vector<UncertainGiven> ordered(givens);
+    std::stable_sort(ordered.begin(), ordered.end(), [](const UncertainGiven& a, const UncertainGiven& b)
+    {
+        return a.probabilities.front() > b.probabilities.front();
+    });
+
+    std::vector<std::vector<float>> costs(ordered.size());
+    for(size_t i = 0; i < ordered.size(); ++i)
+        for(const float probability : ordered[i].probabilities)
+            costs[i].push_back(-std::log(std::max(probability, 1e-6f)));
+
+    float bestCost = std::numeric_limits<float>::infinity();
+    std::vector<uint32_t> best;
+    long nodes = 0;
+    searchUncertain(candidates, ordered, costs, 0, 0.0f, bestCost, best, nodes);
+    if(best.empty())
+        return false;
+
+    for(int cell = 0; cell < m_cells; ++cell)
+        puzzle[cell] = lowestBitIndex(best[cell]) + 1;
+    return true;
+}
+
+void Propagator::setCancelFlag(const std::atomic<bool>* cancel)
+{
+    m_cancel = cancel;
+}
+
+int Propagator::size() const
+{
+    return m_N;
+}
@@ -0,0 +1,115 @@
+#ifndef PROPAGATOR_H
+#define PROPAGATOR_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include "bitutils.h"
+
+// Logical techniques reported by the hint API (cheapest first)
+enum class HintTechnique
+{
+    NakedSingle,
+    HiddenSingleBox,
+    HiddenSingleRow,
+    HiddenSingleColumn,
+    LockedCandidates    // Single that appears after pointing/claiming eliminations
+};
+
+// Single deduction: place digit in cell
+struct Hint
+{
+    int cell;
+    int digit;
+    HintTechnique technique;
+};
+
+// Ranked reading of an uncertain given (e.g. from OCR): possible digits with their
+// probabilities, most likely first
+struct UncertainGiven
+{
+    int cell;
+    std::vector<int> digits;
+    std::vector<float> probabilities;
+};
+
+// Constraint propagation engine working on candidate masks.
+// Every cell stores the digits that are still possible as a bit mask (bit d-1 for digit d).
+// Supports sudokus with N = boxSize * boxSize digits (up to 32x32).
+class Propagator
+{
+private:
+    // Member variables
+    const int m_boxSize;
+    const int m_N;
+    const int m_cells;
+    const uint32_t m_allDigits;
+    const int m_EMPTY = 0;
+    std::vector<std::vector<int>> m_units;      // All rows, columns and boxes (cell indices)
+    std::vector<std::vector<int>> m_cellUnits;  // The three units every cell belongs to
+    std::vector<std::vector<int>> m_peers;      // All cells sharing a unit with a cell
+    const long m_maxUncertainNodes = 200000;    // Search budget of solveUncertain
+    const long m_coreTrialNodes = 20000;        // Search budget of a conflictCore trial
+    const long m_corePoolNodes = 200000;        // Shared by the first check and the retried trials of conflictCore
+    const std::atomic<bool>* m_cancel;          // Optional flag to abort a running search
+
+    /* ----------------------- Private member functions ----------------------- */
+    bool eliminate(std::vector<uint32_t>& candidates, const int cell, const int digit) const;
+    bool assign(std::vector<uint32_t>& candidates, const int cell, const int digit) const;
+    int search(std::vector<uint32_t>& candidates, const int limit, std::vector<uint32_t>* solution,
+               long* nodes = nullptr) const;
+    // 1 if the puzzle has a solution, 0 if it has none, -1 if the search ran out of nodes (or was cancelled).
+    // The searched nodes are taken from nodes.
+    int boundedSolvable(const std::vector<int>& puzzle, long& nodes) const;
+    bool cancelled() const;
+    bool basicCandidates(const std::vector<int>& puzzle, std::vector<uint32_t>& candidates) const;
+    bool findSingle(const std::vector<int>& puzzle, const std::vector<uint32_t>& candidates, Hint& hint) const;
+    bool eliminateLockedCandidates(const std::vector<int>& puzzle, std::vector<uint32_t>& candidates) const;
+    void findRedundantClues(const std::vector<uint32_t>& candidates, const std::vector<int>& clues, const int first, const int last,
+                            const std::vector<int>& solution, std::vector<int>& redundantClues) const;
+    void searchUncertain(const std::vector<uint32_t>& candidates, const std::vector<UncertainGiven>& givens,
+                         const std::vector<std::vector<float>>& costs, const size_t index, const float cost,
+                         float& bestCost, std::vector<uint32_t>& best, long& nodes) const;
+
+public:
+    explicit Propagator(const int boxSize = 3); // Constructor
+    ~Propagator();                              // Destructor
+
+    /* ----------------------- Public member functions ----------------------- */
+    // Fill the candidate masks from the givens and propagate singles (false on contradiction)
+    bool load(const std::vector<int>& puzzle, std::vector<uint32_t>& candidates) const;
+
+    // Solve with propagation and minimum-remaining-values branching
+    bool solve(std::vector<int>& puzzle) const;
+
+    // Count the solutions of a puzzle, stops as soon as the limit is reached
+    int countSolutions(const std::vector<int>& puzzle, const int limit) const;
+
+    // Set of givens (cell indices) that together make the puzzle unsolvable (empty if the puzzle is
+    // solvable or its unsolvability cannot be shown within the search budget). Every deletion trial
+    // has a node budget, trials that run out of it are retried on the smaller core with doubled
+    // budgets from a shared pool of nodes. A given whose trial is still undecided when the pool is
+    // used up is kept, then the core is unsolvable but not guaranteed to be minimal.
+    std::vector<int> conflictCore(const std::vector<int>& puzzle) const;
+
+    // Cheapest single logical deduction without solving the puzzle (false if there is none)
+    bool nextHint(const std::vector<int>& puzzle, Hint& hint) const;
+
+    // True if the puzzle has a unique solution and every given is necessary for it.
+    // The givens that could be removed without losing uniqueness are stored in redundantClues.
+    bool isMinimal(const std::vector<int>& puzzle, std::vector<int>* redundantClues = nullptr) const;
+
+    // Solve a puzzle with uncertain givens: puzzle holds the certain givens, the cells of the uncertain
+    // givens may only take one of their listed digits. Finds the solution whose digits for the uncertain
+    // givens are most likely together (branch and bound on the sum of -log(probability)), the uncertain
+    // givens are committed in order of decreasing confidence. Returns false if no digit choice is solvable.
+    bool solveUncertain(std::vector<int>& puzzle, const std::vector<UncertainGiven>& givens) const;
+
+    // Abort running searches as soon as the flag becomes true (nullptr disables it)
+    void setCancelFlag(const std::atomic<bool>* cancel);
+
+    int size() const;
+};
+
+#endif // PROPAGATOR_H
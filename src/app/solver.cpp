@@ -1,6 +1,10 @@
 #include "solver.h"
 
-Solver::Solver(){}
+Solver::Solver(const int boxSize)
+    : m_boxSize(boxSize)
+    , N(boxSize * boxSize)
+    , m_propagator(boxSize)
+{}
 
 Solver::~Solver(){}
 
@@ -73,19 +77,19 @@ bool Solver::boxChecker(std::vector<int> puzzle, const int row, const int col)
     // Only check for valid row number
     if(col<N && col>=0)
     {
-        // Define vector for subsquare (3x3)
+        // Define vector for subsquare (boxSize x boxSize)
         std::vector<int> subSquare;
 
         // Get the first row and first column of the subsquare
-        const int firstRow = (row/3)*3;
-        const int firstCol = (col/3)*3;
+        const int firstRow = (row/m_boxSize)*m_boxSize;
+        const int firstCol = (col/m_boxSize)*m_boxSize;
 
         std::vector<int>::iterator it = puzzle.begin() + (firstRow*N + firstCol);
 
         // store values from subsquare in vector
-        for(int i = 0; i < 3; ++i)
+        for(int i = 0; i < m_boxSize; ++i)
         {
-            for(int j = 0; j < 3; ++j)
+            for(int j = 0; j < m_boxSize; ++j)
             {
                 subSquare.push_back(*(it+j));
             }
@@ -147,21 +151,21 @@ bool Solver::selectionChecker(std::vector<int> puzzle, const int row, const int
 
     /* 3) Check if number is unique in box */
     // get the first row and first column of the subsquare
-    const int firstRow = (row/3)*3;
-    const int firstCol = (col/3)*3;
+    const int firstRow = (row/m_boxSize)*m_boxSize;
+    const int firstCol = (col/m_boxSize)*m_boxSize;
 
     it = puzzle.begin() + (firstRow*N + firstCol);
 
     // store values from subsquare in vector
-    for(int i = 0; i < 3; ++i)
+    for(int i = 0; i < m_boxSize; ++i)
     {
-        for(int j = 0; j < 3; ++j)
+        for(int j = 0; j < m_boxSize; ++j)
         {
             if(*it == *selected && it != selected)
                 return false;
             ++it;
         }
-        it += (N-3);
+        it += (N-m_boxSize);
     }
     return true;
 }
@@ -184,6 +188,45 @@ bool Solver::findNextEmptyCell(std::vector<int> puzzle, int &row, int &col)
     return false;
 }
 
+// Checks that the givens are digits of the grid and that no two of them conflict
+bool Solver::givensChecker(const std::vector<int>& puzzle)
+{
+    if(static_cast<int>(puzzle.size()) != N * N)
+        return false;
+
+    for(int index = 0; index < N * N; ++index)
+    {
+        if(puzzle[index] == m_EMPTY)
+            continue;
+        if(puzzle[index] < 1 || puzzle[index] > N || !selectionChecker(puzzle, index / N, index % N))
+            return false;
+    }
+    return true;
+}
+
+// Checks that the grid is completely and validly filled and keeps all givens of the puzzle
+bool Solver::solutionChecker(const std::vector<int>& grid, const std::vector<int>& puzzle)
+{
+    if(grid.size() != puzzle.size() || static_cast<int>(grid.size()) != N * N)
+        return false;
+
+    for(int index = 0; index < N * N; ++index)
+    {
+        if(puzzle[index] != m_EMPTY && puzzle[index] != grid[index])
+            return false;
+    }
+
+    // Every row and column once, every box through its top left cell
+    for(int i = 0; i < N; ++i)
+    {
+        const int boxRow = (i / m_boxSize) * m_boxSize;
+        const int boxCol = (i % m_boxSize) * m_boxSize;
+        if(!rowChecker(grid, i) || !colChecker(grid, i) || !boxChecker(grid, boxRow, boxCol))
+            return false;
+    }
+    return true;
+}
+
 // Create the sudoku puzzle with the found digits
 std::vector<int> Solver::createSudokuPuzzle(const std::vector<bool> cellWithDigit, const std::string detectedDigits)
 {
@@ -214,6 +257,10 @@ std::vector<int> Solver::createSudokuPuzzle(const std::vector<bool> cellWithDigi
 // Performs backtracking (common algorithm for sudoku solving)
 bool Solver::solve(std::vector<int> &puzzle, int row, int col)
 {
+    /* 0) Stop if another engine already finished the puzzle (portfolio mode) */
+    if(m_cancel != nullptr && m_cancel->load(std::memory_order_relaxed))
+        return false;
+
     /* 1) Check if last row and col is passed --> solved = true */
     if((row == (N-1)) && (col == N))
         return true;
@@ -251,6 +298,212 @@ bool Solver::solve(std::vector<int> &puzzle, int row, int col)
     return false;
 }
 
+// Races backtracking, propagation with MRV, dancing links and (9x9) the band kernel on separate threads.
+// The first engine that finishes (solved or proven unsolvable) wins and cancels the others.
+bool Solver::solvePortfolio(std::vector<int> &puzzle)
+{
+    // Plain backtracking never looks at the givens, so conflicting ones are rejected before the race
+    if(!givensChecker(puzzle))
+        return false;
+
+    std::atomic<bool> cancel(false);
+    std::mutex resultMutex;
+    bool finished = false;
+    bool solved = false;
+    std::vector<int> result;
+
+    // Stores the outcome of the first engine that returns, later ones are ignored.
+    // A solved grid that fails the checks does not win, the other engines keep running.
+    auto report = [&](const SolverEngine engine, const bool success, const std::vector<int>& grid)
+    {
+        if(success && !solutionChecker(grid, puzzle))
+            return;
+
+        std::lock_guard<std::mutex> lock(resultMutex);
+        if(finished)
+            return;
+        finished = true;
+        solved = success;
+        result = grid;
+        m_lastEngine = engine;
+        cancel.store(true);
+    };
+
+    std::vector<std::thread> engines;
+    engines.emplace_back([&]()
+    {
+        std::vector<int> grid(puzzle);
+        Solver backtracker(m_boxSize);
+        backtracker.m_cancel = &cancel;
+        const bool success = backtracker.solve(grid, 0, 0);
+        if(!cancel.load())
+            report(SolverEngine::Backtracking, success, grid);
+    });
+    engines.emplace_back([&]()
+    {
+        std::vector<int> grid(puzzle);
+        Propagator propagator(m_boxSize);
+        propagator.setCancelFlag(&cancel);
+        const bool success = propagator.solve(grid);
+        if(!cancel.load())
+            report(SolverEngine::Propagation, success, grid);
+    });
+    engines.emplace_back([&]()
+    {
+        std::vector<int> grid(puzzle);
+        DancingLinks dlx(m_boxSize);
+        dlx.setCancelFlag(&cancel);
+        const bool success = dlx.solve(grid);
+        if(!cancel.load())
+            report(SolverEngine::DancingLinks, success, grid);
+    });
+
+    // The band kernel is limited to 9x9 grids
+    if(m_boxSize == 3)
+    {
+        engines.emplace_back([&]()
+        {
+            std::vector<int> grid(puzzle);
+            BandSolver bands;
+            bands.setCancelFlag(&cancel);
+            const bool success = bands.solve(grid);
+            if(!cancel.load())
+                report(SolverEngine::Bands, success, grid);
+        });
+    }
+
+    // The losing engines see the cancellation flag and return quickly
+    for(auto& engine : engines)
+        engine.join();
+
+    if(solved)
+        puzzle = result;
+    return solved;
+}
+
+bool Solver::solveWith(const SolverEngine engine, std::vector<int> &puzzle)
+{
+    m_lastEngine = engine;
+    switch(engine)
+    {
+    case SolverEngine::Backtracking:
+        return solve(puzzle, 0, 0);
+    case SolverEngine::Propagation:
+        return m_propagator.solve(puzzle);
+    case SolverEngine::DancingLinks:
+    {
+        DancingLinks dlx(m_boxSize);
+        dlx.setCancelFlag(m_cancel);
+        return dlx.solve(puzzle);
+    }
+    case SolverEngine::CDCL:
+    {
+        CDCLSolver cdcl(m_boxSize);
+        cdcl.setCancelFlag(m_cancel);
+        return cdcl.solve(puzzle);
+    }
+    case SolverEngine::Bands:
+    {
+        if(m_boxSize != 3)
+            return false;
+        BandSolver bands;
+        bands.setCancelFlag(m_cancel);
+        return bands.solve(puzzle);
+    }
+    }
+    return false;
+}
+
+void Solver::setCancelFlag(const std::atomic<bool>* cancel)
+{
+    m_cancel = cancel;
+    m_propagator.setCancelFlag(cancel);
+}
+
+SolverEngine Solver::lastEngine() const
+{
+    return m_lastEngine;
+}
+
+std::string Solver::engineName(const SolverEngine engine)
+{
+    switch(engine)
+    {
+    case SolverEngine::Backtracking: return "backtracking";
+    case SolverEngine::Propagation: return "propagation (MRV)";
+    case SolverEngine::DancingLinks: return "dancing links";
+    case SolverEngine::CDCL: return "CDCL";
+    case SolverEngine::Bands: return "bands (bit-parallel)";
+    }
+    return "unknown";
+}
+
+// Finds the givens responsible for an unsolvable puzzle (most likely OCR misreads)
+std::vector<int> Solver::findConflictCore(const std::vector<int> puzzle)
+{
+    return m_propagator.conflictCore(puzzle);
+}
+
+bool Solver::nextHint(const std::vector<int> puzzle, Hint& hint)
+{
+    return m_propagator.nextHint(puzzle, hint);
+}
+
+bool Solver::isMinimal(const std::vector<int> puzzle, std::vector<int>* redundantClues)
+{
+    return m_propagator.isMinimal(puzzle, redundantClues);
+}
+
+std::vector<UncertainGiven> Solver::createUncertainGivens(const std::vector<bool> cellWithDigit, const std::string detectedDigits,
+                                                          const std::string runnerUps, const std::vector<float> confidences)
+{
+    std::vector<UncertainGiven> givens;
+    size_t index = 0;
+    for(size_t cell = 0; cell < cellWithDigit.size() && index < detectedDigits.size(); ++cell)
+    {
+        if(!cellWithDigit[cell])
+            continue;
+
+        const float confidence = (index < confidences.size()) ? std::min(std::max(confidences[index], 0.0f), 1.0f) : 1.0f;
+        UncertainGiven given;
+        given.cell = static_cast<int>(cell);
+        given.digits.push_back(detectedDigits[index] - '0');
+        given.probabilities.push_back((1.0f + confidence) / 2.0f);
+
+        // Runner-ups that are no digit of this grid ('0', '?', ...) are dropped
+        const int runnerUp = (index < runnerUps.size()) ? runnerUps[index] - '0' : m_EMPTY;
+        if(runnerUp >= 1 && runnerUp <= N && runnerUp != given.digits.front())
+        {
+            given.digits.push_back(runnerUp);
+            given.probabilities.push_back((1.0f - confidence) / 2.0f);
+        }
+        givens.push_back(given);
+        ++index;
+    }
+    return givens;
+}
+
+bool Solver::solveUncertain(std::vector<int>& puzzle, const std::vector<UncertainGiven>& givens)
+{
+    const bool solved = m_propagator.solveUncertain(puzzle, givens);
+    if(solved)
+        m_lastEngine = SolverEngine::Propagation;
+    return solved;
+}
+
+std::string Solver::techniqueName(const HintTechnique technique)
+{
+    switch(technique)
+    {
+    case HintTechnique::NakedSingle: return "naked single";
+    case HintTechnique::HiddenSingleBox: return "hidden single (box)";
+    case HintTechnique::HiddenSingleRow: return "hidden single (row)";
+    case HintTechnique::HiddenSingleColumn: return "hidden single (column)";
+    case HintTechnique::LockedCandidates: return "locked candidates";
+    }
+    return "unknown";
+}
+
 // Print the sudoku to terminal
 void Solver::printSudoku(std::vector<int> sudoku)
 {
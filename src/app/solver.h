@@ -8,13 +8,35 @@
 #include <chrono>
 #include <set>
 #include <sstream>
+#include <string>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include "propagator.h"
+#include "dlx.h"
+#include "cdcl.h"
+#include "bandsolver.h"
+
+// Solving strategies that are raced against each other in portfolio mode
+enum class SolverEngine
+{
+    Backtracking,
+    Propagation,
+    DancingLinks,
+    CDCL,
+    Bands
+};
 
 class Solver
 {
 private:
     // Member variables
-    const int N = 9;
+    const int m_boxSize;
+    const int N;
     const int m_EMPTY = 0;
+    Propagator m_propagator;
+    const std::atomic<bool>* m_cancel = nullptr;            // Aborts the backtracking (portfolio mode)
+    SolverEngine m_lastEngine = SolverEngine::Backtracking; // Winner of the last portfolio race
 
     /* ----------------------- Private member functions ----------------------- */
     bool rowChecker(std::vector<int> puzzle, const int row);
@@ -22,16 +44,50 @@ private:
     bool boxChecker(std::vector<int> puzzle, const int row, const int col);
     bool selectionChecker(std::vector<int> puzzle, const int row, const int col);
     bool findNextEmptyCell(std::vector<int> puzzle, int& row, int &col);
+    bool givensChecker(const std::vector<int>& puzzle);
+    bool solutionChecker(const std::vector<int>& grid, const std::vector<int>& puzzle);
 
 public:
-    Solver();   // Constructor
+    explicit Solver(const int boxSize = 3);   // Constructor
     ~Solver();  // Destructor
 
     /* ----------------------- Public member functions ----------------------- */
     bool checker(const std::vector<int> puzzle, const int row, const int col);
     bool solve(std::vector<int>& puzzle, int row, int col);
+
+    // Runs all engines concurrently and keeps the result of the first one that finishes
+    // (conflicting givens are rejected up front, a solved grid only counts if it passes the checks)
+    bool solvePortfolio(std::vector<int>& puzzle);
+
+    // Solves with one explicitly selected engine
+    // (CDCL is meant for 16x16 and larger grids, Bands only supports 9x9)
+    bool solveWith(const SolverEngine engine, std::vector<int>& puzzle);
+
+    // Abort running solves as soon as the flag becomes true (nullptr disables it)
+    void setCancelFlag(const std::atomic<bool>* cancel);
+    SolverEngine lastEngine() const;
+    static std::string engineName(const SolverEngine engine);
     void printSudoku(std::vector<int> sudoku);
     std::vector<int> createSudokuPuzzle(const std::vector<bool> cellWithDigit, const std::string detectedDigits);
+
+    // Returns the cell indices of a set of givens that make the puzzle unsolvable
+    // (minimal unless the search budget of the propagator ran out, see Propagator::conflictCore)
+    std::vector<int> findConflictCore(const std::vector<int> puzzle);
+
+    // Returns the cheapest next logical step (cell, digit, technique) without solving the puzzle
+    bool nextHint(const std::vector<int> puzzle, Hint& hint);
+    static std::string techniqueName(const HintTechnique technique);
+
+    // True if the solution is unique and no given can be removed without losing uniqueness
+    bool isMinimal(const std::vector<int> puzzle, std::vector<int>* redundantClues = nullptr);
+
+    // Uncertain givens from the OCR result: every detected digit may also be its runner-up
+    // (runnerUps[i] outside '1'..N means there is none), confidence c gives the probabilities (1+c)/2 and (1-c)/2
+    std::vector<UncertainGiven> createUncertainGivens(const std::vector<bool> cellWithDigit, const std::string detectedDigits,
+                                                      const std::string runnerUps, const std::vector<float> confidences);
+
+    // Solves with the most likely consistent reading of the uncertain givens, puzzle holds the certain givens
+    bool solveUncertain(std::vector<int>& puzzle, const std::vector<UncertainGiven>& givens);
 };
 
 #endif // SOLVER_H
@@ -0,0 +1,120 @@
+#include "templateclassifier.h"
+#include <cmath>
+#include <limits>
+#include <map>
+
+TemplateClassifier::TemplateClassifier()
+    : m_dims(0)
+{}
+
+TemplateClassifier::~TemplateClassifier(){}
+
+void TemplateClassifier::normalise(float* values, const int count)
+{
+    float mean = 0.0f;
+    for(int i = 0; i < count; ++i)
+        mean += values[i];
+    mean /= count;
+
+    float norm = 0.0f;
+    for(int i = 0; i < count; ++i)
+    {
+        values[i] -= mean;
+        norm += values[i] * values[i];
+    }
+
+    // A constant cell (e.g. empty) stays all zero and correlates with nothing
+    const float scale = (norm > 0.0f) ? 1.0f / std::sqrt(norm) : 0.0f;
+    for(int i = 0; i < count; ++i)
+        values[i] *= scale;
+}
+
+bool TemplateClassifier::train(const cv::Mat& samples, const cv::Mat& labels)
+{
+    m_dims = 0;
+    m_labels.clear();
+    m_templates.clear();
+    if(samples.empty() || samples.type() != CV_8UC1 || labels.type() != CV_32SC1 || labels.total() != static_cast<size_t>(samples.rows))
+        return false;
+
+    // Sum the samples of every label
+    const int dims = samples.cols;
+    std::map<int, std::vector<float>> sums;
+    for(int i = 0; i < samples.rows; ++i)
+    {
+        std::vector<float>& sum = sums[labels.at<int>(i)];
+        sum.resize(dims, 0.0f);
+        const uint8_t* row = samples.ptr(i);
+        for(int j = 0; j < dims; ++j)
+            sum[j] += row[j];
+    }
+
+    // The scale of the mean does not matter after normalising
+    m_dims = dims;
+    for(auto& entry : sums)
+    {
+        normalise(entry.second.data(), dims);
+        m_labels.push_back(entry.first);
+        m_templates.insert(m_templates.end(), entry.second.begin(), entry.second.end());
+    }
+    return true;
+}
+
+bool TemplateClassifier::empty() const
+{
+    return m_labels.empty();
+}
+
+int TemplateClassifier::dims() const
+{
+    return m_dims;
+}
+
+std::vector<CellPrediction> TemplateClassifier::classify(const cv::Mat& samples) const
+{
+    std::vector<CellPrediction> predictions;
+    if(empty() || samples.type() != CV_8UC1 || samples.cols != m_dims)
+        return predictions;
+
+    const int templateCount = static_cast<int>(m_labels.size());
+    std::vector<float> query(m_dims);
+    predictions.reserve(samples.rows);
+    for(int i = 0; i < samples.rows; ++i)
+    {
+        const uint8_t* row = samples.ptr(i);
+        for(int j = 0; j < m_dims; ++j)
+            query[j] = row[j];
+        normalise(query.data(), m_dims);
+
+        // Distance 1 - correlation, the two best templates give label and runner-up
+        int best = -1;
+        int second = -1;
+        float bestDistance = std::numeric_limits<float>::max();
+        float secondDistance = std::numeric_limits<float>::max();
+        for(int t = 0; t < templateCount; ++t)
+        {
+            const float* values = &m_templates[static_cast<size_t>(t) * m_dims];
+            float correlation = 0.0f;
+            for(int j = 0; j < m_dims; ++j)
+                correlation += values[j] * query[j];
+
+            const float distance = 1.0f - correlation;
+            if(distance < bestDistance)
+            {
+                second = best;
+                secondDistance = bestDistance;
+                best = t;
+                bestDistance = distance;
+            }
+            else if(distance < secondDistance)
+            {
+                second = t;
+                secondDistance = distance;
+            }
+        }
+
+        predictions.push_back(CellPrediction{char(m_labels[best]), second >= 0 ? char(m_labels[second]) : char(0),
+                                             distanceConfidence(bestDistance, secondDistance, second >= 0)});
+    }
+    return predictions;
+}
@@ -0,0 +1,31 @@
+#ifndef TEMPLATECLASSIFIER_H
+#define TEMPLATECLASSIFIER_H
+
+#include "digitclassifier.h"
+
+// Template matching: one mean template per digit, compared to the cell with the
+// normalised cross correlation (zero mean, unit length vectors --> one dot product
+// per template). Only 9 comparisons per cell, independent of the training set size.
+class TemplateClassifier : public DigitClassifier
+{
+private:
+    // Member variables
+    int m_dims;
+    std::vector<int> m_labels;          // Label of every template
+    std::vector<float> m_templates;     // m_labels.size() x m_dims, zero mean and unit length
+
+    /* ----------------------- Private member functions ----------------------- */
+    static void normalise(float* values, const int count);
+
+public:
+    TemplateClassifier();   // Constructor
+    ~TemplateClassifier();  // Destructor
+
+    /* ----------------------- Public member functions ----------------------- */
+    bool train(const cv::Mat& samples, const cv::Mat& labels) override;
+    bool empty() const override;
+    int dims() const override;
+    std::vector<CellPrediction> classify(const cv::Mat& samples) const override;
+};
+
+#endif // TEMPLATECLASSIFIER_H
@@ -0,0 +1,490 @@
+#include "trainer.h"
+#include "nearestneighbour.h"
+#include "imageprocessing.h"
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+namespace
+{
+// Training cells per classification chunk of the condensation
+const int condenseChunk = 64;
+
+std::vector<int> classify(const cv::Mat& trainSamples, const cv::Mat& trainLabels, const cv::Mat& queries)
+{
+    NearestNeighbour nearest;
+    nearest.train(trainSamples.ptr(), trainSamples.step, trainSamples.rows, trainSamples.cols, trainLabels.ptr<int>());
+    std::vector<int> predicted(queries.rows);
+    nearest.findNearest(queries.ptr(), queries.step, queries.rows, predicted.data());
+    return predicted;
+}
+}
+
+const int Trainer::m_canvasSize;
+
+Trainer::Trainer(const int cellWidth, const int cellHeight)
+    : m_cellWidth(cellWidth)
+    , m_cellHeight(cellHeight)
+{}
+
+Trainer::~Trainer(){}
+
+bool Trainer::addSamples(const cv::Mat& samples, const cv::Mat& labels)
+{
+    if(samples.empty())
+        return true;
+
+    cv::Mat byteSamples;
+    cv::Mat intLabels;
+    samples.convertTo(byteSamples, CV_8U);
+    labels.reshape(1, static_cast<int>(labels.total())).convertTo(intLabels, CV_32S);
+    if(byteSamples.channels() != 1 || byteSamples.cols != m_cellWidth * m_cellHeight || byteSamples.rows != intLabels.rows)
+    {
+        std::cout << "Error: Training images and classification digits do not match!" << std::endl;
+        return false;
+    }
+
+    m_samples.push_back(byteSamples);
+    m_labels.push_back(intLabels);
+    return true;
+}
+
+bool Trainer::readTrainingFiles(const std::string& classFile, const std::string& trainedFile)
+{
+    cv::Mat classificationImg;
+    cv::Mat trainingImg;
+
+    cv::FileStorage fs_class(classFile, cv::FileStorage::READ);
+    if(!fs_class.isOpened())
+    {
+        std::cout << "Error: Classification file not found!" << std::endl;
+        return false;
+    }
+    fs_class["classificationDigits"] >> classificationImg;
+    fs_class.release();
+
+    cv::FileStorage fs_images(trainedFile, cv::FileStorage::READ);
+    if(!fs_images.isOpened())
+    {
+        std::cout << "Error: training images file not found!" << std::endl;
+        return false;
+    }
+    fs_images["trainedImages"] >> trainingImg;
+    fs_images.release();
+
+    return addSamples(trainingImg, classificationImg);
+}
+
+std::vector<cv::Rect> Trainer::findDigitBoxes(const cv::Mat& thresholdImg) const
+{
+    // Outer contours only: the holes of 0, 4, 6, 8 and 9 are no digits
+    cv::Mat contourImg = thresholdImg.clone();
+    std::vector<std::vector<cv::Point>> contours;
+    cv::findContours(contourImg, contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
+
+    std::vector<cv::Rect> boxes;
+    for(const auto& contour : contours)
+    {
+        const double area = cv::contourArea(contour);
+        if(area >= m_minContourArea && area < m_maxContourArea)
+            boxes.push_back(cv::boundingRect(contour));
+    }
+    if(boxes.empty())
+        return boxes;
+
+    // Group the boxes into text lines: a box whose vertical center lies within half a
+    // (median) digit height of the current line belongs to it
+    std::vector<int> heights;
+    for(const cv::Rect& box : boxes)
+        heights.push_back(box.height);
+    std::nth_element(heights.begin(), heights.begin() + heights.size() / 2, heights.end());
+    const double tolerance = heights[heights.size() / 2] / 2.0;
+
+    std::sort(boxes.begin(), boxes.end(), [](const cv::Rect& a, const cv::Rect& b)
+    {
+        return a.y * 2 + a.height < b.y * 2 + b.height;
+    });
+
+    std::vector<cv::Rect> ordered;
+    size_t lineStart = 0;
+    for(size_t i = 1; i <= boxes.size(); ++i)
+    {
+        const double lineCenter = boxes[lineStart].y + boxes[lineStart].height / 2.0;
+        if(i < boxes.size() && boxes[i].y + boxes[i].height / 2.0 - lineCenter <= tolerance)
+            continue;
+
+        std::sort(boxes.begin() + lineStart, boxes.begin() + i, [](const cv::Rect& a, const cv::Rect& b)
+        {
+            return a.x < b.x;
+        });
+        ordered.insert(ordered.end(), boxes.begin() + lineStart, boxes.begin() + i);
+        lineStart = i;
+    }
+    return ordered;
+}
+
+bool Trainer::extractSheet(const std::string& imagePath, const std::string& digits, cv::Mat& samples, cv::Mat& labels) const
+{
+    const cv::Mat sheet = cv::imread(imagePath);
+    if(sheet.empty())
+    {
+        std::cout << "Error: training sheet " << imagePath << " not found!" << std::endl;
+        return false;
+    }
+
+    // Same preprocessing as the interactive training
+    ImageProcessing imgProcess;
+    const cv::Mat thresholdImg = imgProcess.preprocWithGauss(sheet, cv::THRESH_BINARY_INV);
+    const std::vector<cv::Rect> boxes = findDigitBoxes(thresholdImg);
+
+    std::string labelChars;
+    for(const char c : digits)
+        if(!std::isspace(static_cast<unsigned char>(c)))
+            labelChars += c;
+    if(labelChars.size() != boxes.size())
+    {
+        std::cout << "Error: " << imagePath << " has " << boxes.size() << " digit contours but "
+                  << labelChars.size() << " labels!" << std::endl;
+        return false;
+    }
+
+    samples.create(0, m_cellWidth * m_cellHeight, CV_8U);
+    labels.create(0, 1, CV_32S);
+    for(size_t i = 0; i < boxes.size(); ++i)
+    {
+        if(labelChars[i] == '.')
+            continue;
+        if(labelChars[i] < '1' || labelChars[i] > '9')
+        {
+            std::cout << "Error: invalid label '" << labelChars[i] << "' for " << imagePath << std::endl;
+            return false;
+        }
+
+        cv::Mat resizedCell;
+        cv::resize(thresholdImg(boxes[i]), resizedCell, cv::Size(m_cellWidth, m_cellHeight));
+        samples.push_back(resizedCell.reshape(1, 1));
+        labels.push_back(static_cast<int>(labelChars[i]));
+    }
+    return true;
+}
+
+bool Trainer::addTrainingSheets(const std::vector<std::string>& imagePaths, const std::vector<std::string>& digits)
+{
+    if(imagePaths.size() != digits.size())
+        return false;
+
+    // Every sheet is extracted into its own slot, the results are appended in manifest order
+    const int sheetCount = static_cast<int>(imagePaths.size());
+    std::vector<cv::Mat> sheetSamples(sheetCount);
+    std::vector<cv::Mat> sheetLabels(sheetCount);
+    std::vector<uint8_t> extracted(sheetCount, 0);
+    cv::parallel_for_(cv::Range(0, sheetCount), [&](const cv::Range& range)
+    {
+        for(int i = range.start; i < range.end; ++i)
+            extracted[i] = extractSheet(imagePaths[i], digits[i], sheetSamples[i], sheetLabels[i]) ? 1 : 0;
+    });
+
+    for(int i = 0; i < sheetCount; ++i)
+    {
+        if(!extracted[i] || !addSamples(sheetSamples[i], sheetLabels[i]))
+            return false;
+        std::cout << imagePaths[i] << ": " << sheetSamples[i].rows << " cells" << std::endl;
+    }
+    return true;
+}
+
+bool Trainer::readManifest(const std::string& path)
+{
+    std::ifstream manifest(path);
+    if(!manifest)
+    {
+        std::cout << "Error: manifest " << path << " not found!" << std::endl;
+        return false;
+    }
+
+    // Image paths are relative to the manifest
+    const size_t separator = path.find_last_of("/\\");
+    const std::string directory = (separator == std::string::npos) ? std::string() : path.substr(0, separator + 1);
+
+    std::vector<std::string> imagePaths;
+    std::vector<std::string> digits;
+    std::string line;
+    while(std::getline(manifest, line))
+    {
+        const size_t comment = line.find('#');
+        if(comment != std::string::npos)
+            line.erase(comment);
+
+        std::istringstream entry(line);
+        std::string image;
+        if(!(entry >> image))
+            continue;
+
+        std::string labels;
+        std::string token;
+        while(entry >> token)
+            labels += token;
+        imagePaths.push_back(directory + image);
+        digits.push_back(labels);
+    }
+    return addTrainingSheets(imagePaths, digits);
+}
+
+bool Trainer::addCellDirectory(const std::string& directory)
+{
+    std::vector<std::string> files;
+    std::vector<int> fileLabels;
+    for(char digit = '1'; digit <= '9'; ++digit)
+    {
+        std::vector<cv::String> digitFiles;
+        cv::glob(directory + "/" + digit + "/*", digitFiles, false);
+        for(const cv::String& file : digitFiles)
+        {
+            files.push_back(file);
+            fileLabels.push_back(digit);
+        }
+    }
+    if(files.empty())
+    {
+        std::cout << "Error: no cell images found in " << directory << std::endl;
+        return false;
+    }
+
+    // Load and normalise directly into the rows of the preallocated sample matrix
+    const int count = static_cast<int>(files.size());
+    cv::Mat samples(count, m_cellWidth * m_cellHeight, CV_8U);
+    std::vector<uint8_t> loaded(count, 0);
+    cv::parallel_for_(cv::Range(0, count), [&](const cv::Range& range)
+    {
+        for(int i = range.start; i < range.end; ++i)
+        {
+            const cv::Mat cell = cv::imread(files[i], cv::IMREAD_GRAYSCALE);
+            if(cell.empty())
+                continue;
+            cv::Mat sampleCell = samples.row(i).reshape(1, m_cellHeight);
+            cv::resize(cell, sampleCell, cv::Size(m_cellWidth, m_cellHeight));
+            loaded[i] = 1;
+        }
+    });
+
+    // Skip files that are no images
+    cv::Mat validSamples;
+    cv::Mat validLabels;
+    for(int i = 0; i < count; ++i)
+    {
+        if(!loaded[i])
+            continue;
+        validSamples.push_back(samples.row(i));
+        validLabels.push_back(fileLabels[i]);
+    }
+
+    std::cout << directory << ": " << validSamples.rows << " cells" << std::endl;
+    return addSamples(validSamples, validLabels);
+}
+
+void Trainer::renderSynthetic(const int digit, cv::RNG& rng, cv::Mat& canvas, cv::Mat& warped, cv::Mat& cell) const
+{
+    static const int fonts[] = {cv::FONT_HERSHEY_SIMPLEX, cv::FONT_HERSHEY_PLAIN, cv::FONT_HERSHEY_DUPLEX,
+                                cv::FONT_HERSHEY_COMPLEX, cv::FONT_HERSHEY_TRIPLEX, cv::FONT_HERSHEY_COMPLEX_SMALL,
+                                cv::FONT_HERSHEY_SCRIPT_SIMPLEX, cv::FONT_HERSHEY_SCRIPT_COMPLEX};
+    const int fontCount = sizeof(fonts) / sizeof(fonts[0]);
+
+    int font = fonts[rng.uniform(0, fontCount)];
+    if(rng.uniform(0, 2) == 1)
+        font |= cv::FONT_ITALIC;
+    const int thickness = rng.uniform(1, 5);
+    const std::string text(1, static_cast<char>('0' + digit));
+
+    // Digit height of 12 to 30 pixels whatever the nominal size of the font is, the small
+    // digits get thick and blurry when resized to the cell like the digits of a photo
+    int baseline = 0;
+    const double scale = rng.uniform(12.0, 30.0) / cv::getTextSize(text, font, 1.0, thickness, &baseline).height;
+    const cv::Size textSize = cv::getTextSize(text, font, scale, thickness, &baseline);
+
+    canvas.setTo(cv::Scalar(0));
+    cv::putText(canvas, text, cv::Point((m_canvasSize - textSize.width) / 2, (m_canvasSize + textSize.height) / 2),
+                font, scale, cv::Scalar(255), thickness, cv::LINE_AA);
+
+    // Random rotation and shift
+    const float center = m_canvasSize / 2.0f;
+    cv::Mat transform = cv::getRotationMatrix2D(cv::Point2f(center, center), rng.uniform(-10.0, 10.0), 1.0);
+    transform.at<double>(0, 2) += rng.uniform(-3.0, 3.0);
+    transform.at<double>(1, 2) += rng.uniform(-3.0, 3.0);
+    cv::warpAffine(canvas, warped, transform, canvas.size());
+
+    // The bounding box is taken before the noise, like the digit contour of the sudoku cell
+    cv::threshold(warped, canvas, 127, 255, cv::THRESH_BINARY);
+    cv::Rect box = cv::boundingRect(canvas);
+    if(box.area() == 0)
+    {
+        cell.setTo(cv::Scalar(0));
+        return;
+    }
+
+    // Pixel noise on the anti aliased edges, then binarise like the adaptive threshold does
+    cv::Mat noise(warped.size(), CV_16S);
+    rng.fill(noise, cv::RNG::NORMAL, 0.0, rng.uniform(0.0, 40.0));
+    cv::Mat noisy;
+    cv::add(warped, noise, noisy, cv::noArray(), CV_16S);
+    cv::compare(noisy, cv::Scalar(128), canvas, cv::CMP_GE);
+
+    // Imprecise bounding box: every side moves by up to one pixel
+    const int left = std::max(0, box.x + rng.uniform(-1, 2));
+    const int top = std::max(0, box.y + rng.uniform(-1, 2));
+    const int right = std::min(m_canvasSize, box.x + box.width + rng.uniform(-1, 2));
+    const int bottom = std::min(m_canvasSize, box.y + box.height + rng.uniform(-1, 2));
+    if(right > left && bottom > top)
+        box = cv::Rect(left, top, right - left, bottom - top);
+
+    cv::resize(canvas(box), cell, cv::Size(m_cellWidth, m_cellHeight));
+}
+
+void Trainer::addSynthetic(const int samplesPerDigit, const uint64_t seed)
+{
+    if(samplesPerDigit <= 0)
+        return;
+
+    const int count = 9 * samplesPerDigit;
+    const int firstRow = m_samples.rows;
+    cv::Mat samples(count, m_cellWidth * m_cellHeight, CV_8U);
+    cv::Mat labels(count, 1, CV_32S);
+
+    cv::parallel_for_(cv::Range(0, count), [&](const cv::Range& range)
+    {
+        cv::Mat canvas(m_canvasSize, m_canvasSize, CV_8U);
+        cv::Mat warped(m_canvasSize, m_canvasSize, CV_8U);
+        for(int i = range.start; i < range.end; ++i)
+        {
+            // Digits alternate, so any prefix of the rows is balanced
+            const int digit = 1 + i % 9;
+            cv::RNG rng(seed + static_cast<uint64_t>(firstRow + i) * 0x9E3779B97F4A7C15ULL);
+            cv::Mat cell = samples.row(i).reshape(1, m_cellHeight);
+            renderSynthetic(digit, rng, canvas, warped, cell);
+            labels.at<int>(i) = '0' + digit;
+        }
+    });
+
+    m_samples.push_back(samples);
+    m_labels.push_back(labels);
+}
+
+const cv::Mat& Trainer::samples() const
+{
+    return m_samples;
+}
+
+const cv::Mat& Trainer::labels() const
+{
+    return m_labels;
+}
+
+int Trainer::size() const
+{
+    return m_samples.rows;
+}
+
+int Trainer::cellWidth() const
+{
+    return m_cellWidth;
+}
+
+int Trainer::cellHeight() const
+{
+    return m_cellHeight;
+}
+
+std::vector<int> Trainer::condense(const cv::Mat& samples, const cv::Mat& labels)
+{
+    std::vector<int> kept;
+    if(samples.empty())
+        return kept;
+
+    std::vector<bool> isKept(samples.rows, false);
+    cv::Mat keptSamples = samples.row(0).clone();
+    cv::Mat keptLabels = labels.row(0).clone();
+    kept.push_back(0);
+    isKept[0] = true;
+
+    // Hart's algorithm adds every misclassified sample immediately. Classifying a chunk against the
+    // current prototypes at once gives the same guarantee with one batch call per chunk.
+    bool added = true;
+    while(added)
+    {
+        added = false;
+        for(int first = 0; first < samples.rows; first += condenseChunk)
+        {
+            const int last = std::min(first + condenseChunk, samples.rows);
+            const cv::Mat chunk = samples.rowRange(first, last);
+            const std::vector<int> predicted = classify(keptSamples, keptLabels, chunk);
+
+            for(int i = first; i < last; ++i)
+            {
+                if(isKept[i] || predicted[i - first] == labels.at<int>(i))
+                    continue;
+                kept.push_back(i);
+                isKept[i] = true;
+                keptSamples.push_back(samples.row(i));
+                keptLabels.push_back(labels.row(i));
+                added = true;
+            }
+        }
+    }
+
+    std::sort(kept.begin(), kept.end());
+    return kept;
+}
+
+void Trainer::clusterPrototypes(const cv::Mat& samples, const cv::Mat& labels, const int perClass,
+                                cv::Mat& prototypes, cv::Mat& prototypeLabels)
+{
+    prototypes.release();
+    prototypeLabels.release();
+
+    // Collect the rows of every label
+    std::map<int, std::vector<int>> classRows;
+    for(int i = 0; i < labels.rows; ++i)
+        classRows[labels.at<int>(i)].push_back(i);
+
+    for(const auto& entry : classRows)
+    {
+        cv::Mat classSamples;
+        for(const int row : entry.second)
+            classSamples.push_back(samples.row(row));
+        cv::Mat floatSamples;
+        classSamples.convertTo(floatSamples, CV_32F);
+
+        const int clusters = std::min(perClass, floatSamples.rows);
+        cv::Mat centers;
+        if(clusters == floatSamples.rows)
+            centers = floatSamples;
+        else
+        {
+            cv::Mat assignment;
+            cv::kmeans(floatSamples, clusters, assignment,
+                       cv::TermCriteria(cv::TermCriteria::COUNT + cv::TermCriteria::EPS, 100, 0.1),
+                       3, cv::KMEANS_PP_CENTERS, centers);
+        }
+
+        cv::Mat byteCenters;
+        centers.convertTo(byteCenters, CV_8U);
+        prototypes.push_back(byteCenters);
+        prototypeLabels.push_back(cv::Mat(clusters, 1, CV_32S, cv::Scalar(entry.first)));
+    }
+}
+
+double Trainer::accuracy(const cv::Mat& trainSamples, const cv::Mat& trainLabels,
+                         const cv::Mat& testSamples, const cv::Mat& testLabels)
+{
+    if(trainSamples.empty() || testSamples.empty())
+        return 0.0;
+
+    const std::vector<int> predicted = classify(trainSamples, trainLabels, testSamples);
+    int correct = 0;
+    for(int i = 0; i < testSamples.rows; ++i)
+        if(predicted[i] == testLabels.at<int>(i))
+            ++correct;
+    return static_cast<double>(correct) / testSamples.rows;
+}
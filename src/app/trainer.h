@@ -0,0 +1,89 @@
+#ifndef TRAINER_H
+#define TRAINER_H
+
+#include <string>
+#include <vector>
+#include <opencv2/core.hpp>
+
+// Offline training steps for the OCR model. Holds the labelled training cells
+// (CV_8U pixels, one cell per row, CV_32S ASCII labels), collects them without
+// user interaction from labelled training sheets or cell images and provides the
+// reduction of large training sets to a small prototype set, so the
+// inference cost does not grow with the amount of training data.
+//
+// Manifest format (one training sheet per line, '#' starts a comment):
+//   <image path relative to the manifest> <digits>
+// The digits label the digit contours of the sheet in reading order (top to bottom,
+// left to right across the whole sheet width), whitespace between them is ignored
+// and '.' skips a contour (e.g. a smudge).
+class Trainer
+{
+private:
+    // Member variables
+    const int m_cellWidth;
+    const int m_cellHeight;
+    const int m_maxContourArea = 1000;  // Same limits as the interactive training (OCR)
+    const int m_minContourArea = 60;
+    static const int m_canvasSize = 64;     // Canvas of the synthetic digits
+    cv::Mat m_samples;
+    cv::Mat m_labels;
+
+    /* ----------------------- Private member functions ----------------------- */
+    // Bounding boxes of the digit contours of a thresholded sheet in reading order
+    std::vector<cv::Rect> findDigitBoxes(const cv::Mat& thresholdImg) const;
+
+    // Normalised cells of one sheet, labelled by digits (see manifest format)
+    bool extractSheet(const std::string& imagePath, const std::string& digits, cv::Mat& samples, cv::Mat& labels) const;
+
+    // Render one random variant of digit into cell (m_cellHeight x m_cellWidth CV_8U),
+    // canvas and warped are scratch images of m_canvasSize x m_canvasSize
+    void renderSynthetic(const int digit, cv::RNG& rng, cv::Mat& canvas, cv::Mat& warped, cv::Mat& cell) const;
+
+public:
+    Trainer(const int cellWidth = 20, const int cellHeight = 30);  // Constructor
+    ~Trainer();                                                     // Destructor
+
+    /* ----------------------- Public member functions ----------------------- */
+    // Append labelled cells (any depth, one cell per row) and their labels (float or int)
+    bool addSamples(const cv::Mat& samples, const cv::Mat& labels);
+
+    // Append the cells of the xml files written by the interactive training
+    bool readTrainingFiles(const std::string& classFile, const std::string& trainedFile);
+
+    // Extract the cells of training sheets (in parallel), digits[i] labels imagePaths[i]
+    bool addTrainingSheets(const std::vector<std::string>& imagePaths, const std::vector<std::string>& digits);
+
+    // Extract all sheets listed in a manifest file (see above)
+    bool readManifest(const std::string& path);
+
+    // Append cell images stored as <directory>/<digit>/<name>.<ext> (white digit on black
+    // background like the cells of the sudoku, any size), loaded and resized in parallel
+    bool addCellDirectory(const std::string& directory);
+
+    // Append samplesPerDigit synthetic cells of every digit: Hershey fonts (upright and italic) with
+    // random height, stroke thickness, rotation, shift and noise, binarised, cropped to the digit
+    // and resized like the cells of the sudoku. The cells are generated in parallel straight into
+    // the preallocated sample matrix; every row has its own random generator (derived from seed),
+    // so the result does not depend on the number of threads.
+    void addSynthetic(const int samplesPerDigit, const uint64_t seed = 0x5eed);
+
+    const cv::Mat& samples() const;
+    const cv::Mat& labels() const;
+    int size() const;
+    int cellWidth() const;
+    int cellHeight() const;
+
+    // Condensed nearest neighbour (Hart): indices of a subset of the samples that still classifies
+    // every sample correctly. Misclassified samples are added chunk by chunk until a full pass adds none.
+    static std::vector<int> condense(const cv::Mat& samples, const cv::Mat& labels);
+
+    // Per class k-means: up to perClass centroids (rounded to uint8) for every label
+    static void clusterPrototypes(const cv::Mat& samples, const cv::Mat& labels, const int perClass,
+                                  cv::Mat& prototypes, cv::Mat& prototypeLabels);
+
+    // Share of the test samples that the nearest training sample labels correctly
+    static double accuracy(const cv::Mat& trainSamples, const cv::Mat& trainLabels,
+                           const cv::Mat& testSamples, const cv::Mat& testLabels);
+};
+
+#endif // TRAINER_H
@@ -12,6 +12,12 @@ Widget::Widget(QWidget *parent)
     connect(ui->btn_save, SIGNAL(clicked()), this, SLOT(saveImg()));
     connect(ui->comboBox, SIGNAL(currentIndexChanged(QString)), this, SLOT(reset()));
     this->setFixedSize(1050,781);
+
+    // Load the OCR model once, it is reused for every solved image. A rewritten model
+    // file (e.g. by OCRModelTool) is picked up in the background without a restart.
+    if(myOCR.checkIfFilesExists())
+        myOCR.loadModel();
+    myOCR.watchModel(true);
 }
 
 Widget::~Widget()
@@ -104,8 +110,17 @@ void Widget::plotSolvImg()
             myOCR.writeTrainedImageFile();
         }
 
-        // Run the training sequence for the kNearest       
-        std::string digits = myOCR.train(cellImagesWithDigit);
+        // Load (and if needed train) the selected classifier once, later images reuse the model
+        if(!myOCR.isModelLoaded() && !myOCR.loadModel())
+        {
+            std::cout << "Error, OCR model could not be loaded!" << std::endl;
+            exit(1);
+        }
+
+        // Classify the digits with the loaded model
+        std::vector<CellPrediction> predictions = myOCR.predictCells(cellImagesWithDigit);
+        std::string digits = OCR::toDigits(predictions);
+        std::cout << "The detected digits are: " << digits << std::endl;
 
         std::vector<int> puzzleToSolve = mysolver.createSudokuPuzzle(imgProcess.getCellsWithNumbers(), digits);
 
@@ -113,13 +128,14 @@ void Widget::plotSolvImg()
 
         // -------------------- Solve the sudoku puzzle -------------------- //
 
-        // Initial position to start the solving algorithm
+        // Position of the row, column and box validated by the checker
         int row = 0;
         int col = 0;
 
-        // Perform the algorithm --> Backtracking
-        if(mysolver.solve(puzzleToSolve, row, col))
+        // Race the solving engines and keep the first result
+        if(mysolver.solvePortfolio(puzzleToSolve))
         {
+            std::cout << "Solved by: " << Solver::engineName(mysolver.lastEngine()) << std::endl;
             if(mysolver.checker(puzzleToSolve, row, col))
             {
                 mysolver.printSudoku(puzzleToSolve);
@@ -129,8 +145,58 @@ void Widget::plotSolvImg()
                 std::cout << "Error: Backtracking leads to a wrong result" << std::endl;
         }
         else
+        {
             std::cout << "Error: Sudoku cannot be solved" << std::endl;
 
+            // Only these givens have to be re-classified to make the puzzle solvable again
+            std::vector<int> conflictCells = mysolver.findConflictCore(puzzleToSolve);
+
+            // Index of the OCR prediction of every cell with a digit
+            std::vector<bool> cellsWithNumbers = imgProcess.getCellsWithNumbers();
+            std::vector<int> predictionIndex(cellsWithNumbers.size(), -1);
+            int index = 0;
+            for(size_t cell = 0; cell < cellsWithNumbers.size(); ++cell)
+                if(cellsWithNumbers[cell])
+                    predictionIndex[cell] = index++;
+
+            // The confidences are printed with 2 digits, the previous precision is restored afterwards
+            const std::streamsize precision = std::cout.precision();
+            std::cout << "Conflicting givens (row, col: digit, runner-up, confidence): ";
+            for(const auto& cell : conflictCells)
+            {
+                std::cout << "(" << cell/9 << ", " << cell%9;
+                const int i = (cell < static_cast<int>(predictionIndex.size())) ? predictionIndex[cell] : -1;
+                if(i >= 0 && i < static_cast<int>(predictions.size()))
+                    std::cout << ": " << predictions[i].label << ", " << predictions[i].runnerUp << ", "
+                              << std::setprecision(2) << predictions[i].confidence;
+                std::cout << ") ";
+            }
+            std::cout << std::endl;
+            std::cout.precision(precision);
+
+            // Retry inside the solver: every given may also be its OCR runner-up
+            std::string runnerUps;
+            std::vector<float> confidences;
+            for(const auto& prediction : predictions)
+            {
+                runnerUps += prediction.runnerUp;
+                confidences.push_back(prediction.confidence);
+            }
+            std::vector<UncertainGiven> givens = mysolver.createUncertainGivens(cellsWithNumbers, digits, runnerUps, confidences);
+            std::vector<int> corrected = puzzleToSolve;
+            if(mysolver.solveUncertain(corrected, givens) && mysolver.checker(corrected, row, col))
+            {
+                std::cout << "Solved with corrected givens (row, col: read --> used): ";
+                for(const auto& given : givens)
+                    if(corrected[given.cell] != given.digits.front())
+                        std::cout << "(" << given.cell/9 << ", " << given.cell%9 << ": " << given.digits.front()
+                                  << " --> " << corrected[given.cell] << ") ";
+                std::cout << std::endl;
+                puzzleToSolve = corrected;
+                mysolver.printSudoku(puzzleToSolve);
+            }
+        }
+
         imgProcess.drawMissingDigits(topView, imgProcess.getCellsWithNumbers(), puzzleToSolve);
 
         // Print solved Sudoku image
@@ -0,0 +1,157 @@
+// Reloading a corrupt or truncated binary model (as the ModelWatcher does while a file is
+// being replaced) has to be rejected and keep the current model, as has switching to a backend
+// that cannot use the features of the model.
+#include "ocr.h"
+#include "featureprojection.h"
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <thread>
+
+namespace
+{
+const char* modelPath = "modelreloadtest.bin";
+const int cellWidth = 20;
+const int cellHeight = 30;
+int failures = 0;
+
+void check(const bool condition, const std::string& what)
+{
+    if(!condition)
+    {
+        std::cout << "FAILED: " << what << std::endl;
+        ++failures;
+    }
+}
+
+// One distinct cell per digit (a bar at a different height)
+bool writeModel(const int shift)
+{
+    cv::Mat samples(9, cellWidth * cellHeight, CV_8UC1, cv::Scalar(0));
+    cv::Mat labels(9, 1, CV_32SC1);
+    for(int digit = 0; digit < 9; ++digit)
+    {
+        const int row = (digit * 3 + shift) % cellHeight;
+        samples.row(digit).colRange(row * cellWidth, (row + 1) * cellWidth).setTo(255);
+        labels.at<int>(digit) = '1' + digit;
+    }
+    return ModelFile::write(modelPath, samples, labels, cellWidth, cellHeight);
+}
+
+// The same cells stored as projected features: one component per bar of writeModel(0)
+bool writeProjectedModel()
+{
+    const int inputLength = (cellWidth / 2) * (cellHeight / 2);
+    cv::Mat mean(1, inputLength, CV_32FC1, cv::Scalar(0));
+    cv::Mat basis(9, inputLength, CV_32FC1, cv::Scalar(0));
+    for(int digit = 0; digit < 9; ++digit)
+        basis.row(digit).colRange((digit * 3 / 2) * (cellWidth / 2), (digit * 3 / 2 + 1) * (cellWidth / 2)).setTo(0.05);
+
+    FeatureProjection projection;
+    cv::Mat cells(9, cellWidth * cellHeight, CV_8UC1, cv::Scalar(0));
+    cv::Mat labels(9, 1, CV_32SC1);
+    for(int digit = 0; digit < 9; ++digit)
+    {
+        cells.row(digit).colRange(digit * 3 * cellWidth, (digit * 3 + 1) * cellWidth).setTo(255);
+        labels.at<int>(digit) = '1' + digit;
+    }
+    if(!projection.load(mean, basis, cellWidth, cellHeight))
+        return false;
+    return ModelFile::write(modelPath, projection.project(cells), labels, cellWidth, cellHeight, mean, basis);
+}
+
+std::vector<char> readBytes()
+{
+    std::ifstream file(modelPath, std::ios::binary);
+    return std::vector<char>((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+}
+
+void writeBytes(const std::vector<char>& bytes)
+{
+    std::ofstream file(modelPath, std::ios::binary | std::ios::trunc);
+    file.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+}
+
+// Cell image of the digit of writeModel(shift)
+cv::Mat digitCell(const int digit, const int shift)
+{
+    cv::Mat cell(cellHeight, cellWidth, CV_8UC1, cv::Scalar(0));
+    cell.row((digit * 3 + shift) % cellHeight).setTo(255);
+    return cell;
+}
+}
+
+int main()
+{
+    check(writeModel(0), "model written");
+    const std::vector<char> valid = readBytes();
+
+    OCR ocr;
+    ocr.setModelPath(modelPath);
+    check(ocr.loadModel(), "valid model loaded");
+    const std::shared_ptr<const OCRModel> loaded = ocr.model();
+    check(ocr.predict({digitCell(4, 0)}) == "5", "valid model classifies");
+
+    // Truncated file (fileSize in the header no longer matches)
+    writeBytes(std::vector<char>(valid.begin(), valid.begin() + valid.size() / 2));
+    check(!ocr.loadModel(), "truncated model rejected");
+    check(ocr.model() == loaded, "truncated model keeps the current model");
+
+    // Section table where offset + step * rows wraps around to a value inside the file
+    std::vector<char> corrupt = valid;
+    ModelSection* sections = reinterpret_cast<ModelSection*>(&corrupt[sizeof(ModelHeader)]);
+    for(int i = 0; i < 2; ++i)
+    {
+        sections[i].rows = 16;
+        sections[i].step = 1ULL << 60;
+    }
+    writeBytes(corrupt);
+    check(!ocr.loadModel(), "overflowing section rejected");
+
+    // Unknown element type and a foreign cell size
+    corrupt = valid;
+    reinterpret_cast<ModelSection*>(&corrupt[sizeof(ModelHeader)])[1].elemType = 7;
+    writeBytes(corrupt);
+    check(!ocr.loadModel(), "unknown element type rejected");
+    corrupt = valid;
+    reinterpret_cast<ModelHeader*>(&corrupt[0])->cellWidth = 28;
+    writeBytes(corrupt);
+    check(!ocr.loadModel(), "foreign cell size rejected");
+    check(ocr.model() == loaded, "corrupt models keep the current model");
+
+    // The same through the watcher: a corrupt file is ignored, the next valid one is taken
+    writeBytes(valid);
+    check(ocr.watchModel(true), "watch started");
+    const int attempts = ocr.reloadAttempts();
+    writeBytes(std::vector<char>(valid.begin(), valid.begin() + valid.size() / 3));
+    for(int wait = 0; wait < 40 && ocr.reloadAttempts() == attempts; ++wait)
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    check(ocr.reloadAttempts() > attempts, "watcher reloads the truncated file");
+    check(ocr.failedReloads() > 0, "watcher rejects the truncated file");
+    check(ocr.model() == loaded, "watcher keeps the current model on a truncated file");
+    check(ocr.predict({digitCell(4, 0)}) == "5", "current model still classifies");
+
+    check(writeModel(1), "replacement written");
+    const int failed = ocr.failedReloads();
+    for(int wait = 0; wait < 40 && ocr.model() == loaded; ++wait)
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    check(ocr.model() != loaded, "watcher loads the valid replacement");
+    check(ocr.failedReloads() == failed, "valid replacement is not counted as failed");
+    check(ocr.predict({digitCell(4, 1)}) == "5", "replacement classifies");
+    ocr.watchModel(false);
+
+    // A binarising backend cannot use a model with projected features, the current model stays
+    check(writeProjectedModel(), "projected model written");
+    check(ocr.loadModel(), "projected model loaded");
+    const std::shared_ptr<const OCRModel> projected = ocr.model();
+    check(ocr.predict({digitCell(4, 0)}) == "5", "projected model classifies");
+    check(!ocr.setClassifier("hamming"), "hamming refused on projected features");
+    check(ocr.model() == projected && ocr.classifierName() == "knn", "refused backend keeps the current model");
+    check(ocr.setClassifier("template"), "template accepts projected features");
+    check(ocr.predict({digitCell(4, 0)}) == "5", "template classifies projected features");
+
+    std::remove(modelPath);
+    std::cout << (failures == 0 ? "All model reload checks passed" : "Model reload checks failed") << std::endl;
+    return failures == 0 ? 0 : 1;
+}
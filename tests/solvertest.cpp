@@ -0,0 +1,263 @@
+// Solver checks for inputs that come straight from the OCR: misread givens, conflicting givens
+// and runner-ups that are no digit at all. Also the packed grid storage and the bulk verifier
+// against the scalar checker.
+#include "solver.h"
+#include "gridverifier.h"
+#include <random>
+
+namespace
+{
+int failures = 0;
+
+void check(const bool condition, const std::string& what)
+{
+    if(!condition)
+    {
+        std::cout << "FAILED: " << what << std::endl;
+        ++failures;
+    }
+}
+
+const std::string puzzleText = "53..7....6..195....98....6.8...6...34..8.3..17...2...6.6....28....419..5....8..79";
+
+std::vector<int> parse(const std::string& text)
+{
+    std::vector<int> puzzle;
+    for(const char c : text)
+        puzzle.push_back((c >= '1' && c <= '9') ? c - '0' : 0);
+    return puzzle;
+}
+
+// Digits of the givens and the cells that hold them, as the OCR reports them
+void readGivens(const std::vector<int>& puzzle, std::vector<bool>& cellWithDigit, std::string& digits)
+{
+    cellWithDigit.clear();
+    digits.clear();
+    for(const int digit : puzzle)
+    {
+        cellWithDigit.push_back(digit != 0);
+        if(digit != 0)
+            digits += static_cast<char>('0' + digit);
+    }
+}
+
+// Runner-ups of the uncertain givens: invalid readings ('0', '?') and a misread cell
+void testInvalidRunnerUps()
+{
+    Solver solver;
+    std::vector<int> solution = parse(puzzleText);
+    check(solver.solveWith(SolverEngine::Propagation, solution), "reference puzzle solvable");
+
+    // Cell 1 holds a 3, read as an 8 (conflicts with the 8 in its column) with the 3 as runner-up
+    std::vector<int> misread = parse(puzzleText);
+    misread[1] = 8;
+    std::vector<bool> cellWithDigit;
+    std::string digits;
+    readGivens(misread, cellWithDigit, digits);
+
+    std::string runnerUps(digits.size(), '?');
+    std::vector<float> confidences(digits.size(), 0.9f);
+    runnerUps[0] = '0';
+    runnerUps[1] = '3';
+    confidences[1] = 0.2f;
+    runnerUps[2] = static_cast<char>(0);
+    runnerUps[3] = ':';
+
+    std::vector<UncertainGiven> givens = solver.createUncertainGivens(cellWithDigit, digits, runnerUps, confidences);
+    check(givens.size() == digits.size(), "one uncertain given per detected digit");
+    bool inRange = true;
+    for(const UncertainGiven& given : givens)
+        for(const int digit : given.digits)
+            inRange = inRange && digit >= 1 && digit <= 9;
+    check(inRange, "invalid runner-ups are dropped");
+    check(givens.size() > 1 && givens[1].digits.size() == 2 && givens[1].digits[1] == 3, "valid runner-up is kept");
+
+    std::vector<int> corrected = misread;
+    check(solver.solveUncertain(corrected, givens), "misread puzzle solved with its runner-up");
+    check(corrected == solution, "misread given corrected to the runner-up");
+
+    // The propagator itself skips out of range readings that did not go through createUncertainGivens
+    UncertainGiven raw;
+    raw.cell = 1;
+    raw.digits = {8, 0, 12, -3, 3};
+    raw.probabilities = {0.5f, 0.2f, 0.1f, 0.1f, 0.1f};
+    givens[1] = raw;
+    corrected = misread;
+    check(solver.solveUncertain(corrected, givens), "out of range readings are skipped");
+    check(corrected == solution, "out of range readings do not end up in the grid");
+}
+
+// Conflicting givens must not be "solved" by an engine that does not check them
+void testPortfolioConflicts()
+{
+    Solver solver;
+    std::vector<int> solution = parse(puzzleText);
+    check(solver.solveWith(SolverEngine::Propagation, solution), "reference puzzle solvable");
+
+    std::vector<int> puzzle = parse(puzzleText);
+    check(solver.solvePortfolio(puzzle), "portfolio solves a valid puzzle");
+    check(puzzle == solution, "portfolio result is the solution");
+
+    // A full grid with two swapped cells (backtracking has no empty cell left and would return true)
+    std::vector<int> swapped = solution;
+    std::swap(swapped[0], swapped[1]);
+    for(int run = 0; run < 20; ++run)
+    {
+        std::vector<int> grid = swapped;
+        check(!solver.solvePortfolio(grid), "portfolio rejects a filled grid with conflicting givens");
+        check(grid == swapped, "rejected grid stays unchanged");
+    }
+
+    // Conflicting givens with blanks: the misread 8 of cell 1 repeats the 8 of its column
+    std::vector<int> misread = parse(puzzleText);
+    misread[1] = 8;
+    std::vector<int> grid = misread;
+    check(!solver.solvePortfolio(grid), "portfolio rejects conflicting givens");
+    check(grid == misread, "conflicting puzzle stays unchanged");
+    const std::vector<int> core = solver.findConflictCore(misread);
+    check(!core.empty(), "conflict core is found for the rejected puzzle");
+    std::vector<int> coreOnly(misread.size(), 0);
+    for(const int cell : core)
+        coreOnly[cell] = misread[cell];
+    check(!solver.solveWith(SolverEngine::Propagation, coreOnly), "conflict core alone is unsolvable");
+
+    // Givens that are no digit of the grid
+    std::vector<int> outOfRange = parse(puzzleText);
+    outOfRange[2] = 10;
+    check(!solver.solvePortfolio(outOfRange), "portfolio rejects out of range givens");
+}
+
+// The core has to be minimal: without any one of its givens it becomes solvable
+void testMinimalConflictCore()
+{
+    // Unsolvable without two equal givens in a unit, one deletion trial needs a large search
+    const std::string text = "163508204500020038028034000810907000000016327000243015007009080080072500600400792";
+    std::vector<int> puzzle;
+    for(const char c : text)
+        puzzle.push_back(c - '0');
+
+    Solver solver;
+    const std::vector<int> core = solver.findConflictCore(puzzle);
+    check(!core.empty(), "conflict core found");
+
+    std::vector<int> coreOnly(puzzle.size(), 0);
+    for(const int cell : core)
+        coreOnly[cell] = puzzle[cell];
+    std::vector<int> grid = coreOnly;
+    check(!solver.solveWith(SolverEngine::Propagation, grid), "conflict core alone is unsolvable");
+
+    for(const int cell : core)
+    {
+        grid = coreOnly;
+        grid[cell] = 0;
+        check(solver.solveWith(SolverEngine::Propagation, grid), "core without cell " + std::to_string(cell) + " is solvable");
+    }
+}
+
+// Completed 9x9 grid: shuffled digits of a pattern solution, rows shuffled within their band
+std::vector<int> solvedGrid(std::mt19937& rng)
+{
+    std::vector<int> digits = {1, 2, 3, 4, 5, 6, 7, 8, 9};
+    std::shuffle(digits.begin(), digits.end(), rng);
+    std::vector<int> rows = {0, 1, 2};
+    std::vector<int> grid(81);
+    for(int band = 0; band < 3; ++band)
+    {
+        std::shuffle(rows.begin(), rows.end(), rng);
+        for(int i = 0; i < 3; ++i)
+        {
+            const int row = band * 3 + rows[i];
+            for(int col = 0; col < 9; ++col)
+                grid[(band * 3 + i) * 9 + col] = digits[(3 * (row % 3) + row / 3 + col) % 9];
+        }
+    }
+    return grid;
+}
+
+// Completed grids and copies with one kind of corruption each, 121 grids (the last one repeats
+// the first) so that the last word of the bulk verifier has one lane in use
+std::vector<std::vector<int>> sampleGrids()
+{
+    std::mt19937 rng(31);
+    std::vector<std::vector<int>> grids;
+    for(int i = 0; i < 60; ++i)
+    {
+        std::vector<int> grid = solvedGrid(rng);
+        grids.push_back(grid);
+        const int cell = static_cast<int>(rng() % 81);
+        const int other = (cell / 9) * 9 + (cell % 9 + 1 + static_cast<int>(rng() % 8)) % 9;
+        std::vector<int> corrupt = grid;
+        switch(i % 5)
+        {
+        case 0: corrupt[cell] = corrupt[cell] % 9 + 1; break;       // Another digit
+        case 1: std::swap(corrupt[cell], corrupt[other]); break;    // Swap in a row (the columns break)
+        case 2: corrupt[cell] = 0; break;                           // Empty cell
+        case 3: corrupt[cell] = 10 + static_cast<int>(rng() % 6); break;   // No digit, fits 4 bits
+        case 4: std::swap_ranges(corrupt.begin(), corrupt.begin() + 9, corrupt.begin() + 27); break;    // Rows and columns stay valid
+        }
+        grids.push_back(corrupt);
+    }
+    grids.push_back(grids.front());
+    return grids;
+}
+
+// PackedGrid keeps every cell value of 0-15, the array drops repeated grids
+void testPackedGrids()
+{
+    const std::vector<std::vector<int>> grids = sampleGrids();
+    PackedGridArray packed;
+    for(const std::vector<int>& grid : grids)
+        packed.push_back(grid);
+    check(packed.size() == grids.size(), "packed grid count");
+    for(size_t i = 0; i < grids.size(); ++i)
+        check(packed[i].unpack() == grids[i], "packed grid " + std::to_string(i) + " round trip");
+    check(packed.removeDuplicates() == 1 && packed.size() == grids.size() - 1, "repeated grid removed");
+}
+
+// Scalar reference: Solver::checker holds for the row, column and box of every cell
+bool checkedBySolver(Solver& solver, const std::vector<int>& grid)
+{
+    for(int cell = 0; cell < 81; ++cell)
+    {
+        if(!solver.checker(grid, cell / 9, cell % 9))
+            return false;
+    }
+    return true;
+}
+
+// GridVerifier (single grid and four packed grids per word) against the scalar checker
+void testGridVerifier()
+{
+    const std::vector<std::vector<int>> grids = sampleGrids();
+    PackedGridArray packed;
+    for(const std::vector<int>& grid : grids)
+        packed.push_back(grid);
+
+    Solver solver;
+    GridVerifier verifier;
+    std::vector<uint8_t> valid;
+    const size_t correct = verifier.verify(packed, valid);
+    size_t expected = 0;
+    for(size_t i = 0; i < grids.size(); ++i)
+    {
+        const bool reference = checkedBySolver(solver, grids[i]);
+        expected += reference ? 1 : 0;
+        check(verifier.isValidSolution(grids[i]) == reference, "single grid " + std::to_string(i) + " verified like the checker");
+        check((valid[i] != 0) == reference, "bulk grid " + std::to_string(i) + " verified like the checker");
+    }
+    check(expected == 61, "every corrupted grid fails the checker");
+    check(correct == expected, "bulk verifier counts the valid grids");
+}
+}
+
+int main()
+{
+    testInvalidRunnerUps();
+    testPortfolioConflicts();
+    testMinimalConflictCore();
+    testPackedGrids();
+    testGridVerifier();
+
+    std::cout << (failures == 0 ? "All solver checks passed" : "Solver checks failed") << std::endl;
+    return failures == 0 ? 0 : 1;
+}
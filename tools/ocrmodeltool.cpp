@@ -0,0 +1,481 @@
+// Command line tool for the binary OCR model (see modelfile.h)
+//   OCRModelTool convert <classificationDigits.xml> <trainedImages.xml> <output.bin> [--pca [<components>]]
+//   OCRModelTool compare <classificationDigits.xml> <trainedImages.xml>
+//   OCRModelTool condense <classificationDigits.xml> <trainedImages.xml> <output.bin> [--kmeans <perClass>] [--pca [<components>]]
+//                [--classifier <name>]
+//   OCRModelTool train <output.bin> [--manifest <file>] [--cells <directory>] [--xml <classificationDigits.xml> <trainedImages.xml>]
+//                [--synthetic <samplesPerDigit>]
+//                [--condense | --kmeans <perClass>] [--pca [<components>]] [--classifier <name>]
+#include "modelfile.h"
+#include "digitclassifier.h"
+#include "featureprojection.h"
+#include "trainer.h"
+#include <cstdlib>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <opencv2/ml.hpp>
+
+namespace
+{
+const int cellWidth = 20;
+const int cellHeight = 30;
+const int defaultComponents = 48;
+
+void printUsage()
+{
+    std::cout << "Usage:" << std::endl;
+    std::cout << "  OCRModelTool convert <classificationDigits.xml> <trainedImages.xml> <output.bin> [--pca [<components>]]" << std::endl;
+    std::cout << "  OCRModelTool compare <classificationDigits.xml> <trainedImages.xml>" << std::endl;
+    std::cout << "  OCRModelTool condense <classificationDigits.xml> <trainedImages.xml> <output.bin>"
+                 " [--kmeans <perClass>] [--pca [<components>]] [--classifier <name>]" << std::endl;
+    std::cout << "  OCRModelTool train <output.bin> [--manifest <file>] [--cells <directory>]"
+                 " [--xml <classificationDigits.xml> <trainedImages.xml>] [--synthetic <samplesPerDigit>]"
+                 " [--condense | --kmeans <perClass>] [--pca [<components>]] [--classifier <name>]" << std::endl;
+}
+
+// Reads the xml training files of the interactive training
+bool readTrainingFiles(const std::string& classFile, const std::string& trainedFile, cv::Mat& classificationImg, cv::Mat& trainingImg)
+{
+    cv::FileStorage fs_class(classFile, cv::FileStorage::READ);
+    if(!fs_class.isOpened())
+    {
+        std::cout << "Error: Classification file not found!" << std::endl;
+        return false;
+    }
+    fs_class["classificationDigits"] >> classificationImg;
+    fs_class.release();
+
+    cv::FileStorage fs_images(trainedFile, cv::FileStorage::READ);
+    if(!fs_images.isOpened())
+    {
+        std::cout << "Error: training images file not found!" << std::endl;
+        return false;
+    }
+    fs_images["trainedImages"] >> trainingImg;
+    fs_images.release();
+    return true;
+}
+
+// Float cv::ml::KNearest (k = 1, brute force) as used by the OCR before the registry backends,
+// the reference row of compare
+class KNearestReference : public DigitClassifier
+{
+private:
+    cv::Ptr<cv::ml::KNearest> m_knearest;
+    int m_dims = 0;
+
+public:
+    bool train(const cv::Mat& samples, const cv::Mat& labels) override
+    {
+        cv::Mat trainingImg;
+        cv::Mat classificationImg;
+        samples.convertTo(trainingImg, CV_32FC1);
+        labels.convertTo(classificationImg, CV_32FC1);
+
+        m_knearest = cv::ml::KNearest::create();
+        m_knearest->setIsClassifier(true);
+        m_knearest->setAlgorithmType(cv::ml::KNearest::Types::BRUTE_FORCE);
+        m_knearest->setDefaultK(1);
+        m_dims = samples.cols;
+        return m_knearest->train(trainingImg, cv::ml::ROW_SAMPLE, classificationImg);
+    }
+
+    bool empty() const override
+    {
+        return !m_knearest;
+    }
+
+    int dims() const override
+    {
+        return m_dims;
+    }
+
+    std::vector<CellPrediction> classify(const cv::Mat& samples) const override
+    {
+        cv::Mat queries;
+        cv::Mat knnResults;
+        samples.convertTo(queries, CV_32FC1);
+        m_knearest->findNearest(queries, 1, knnResults);
+
+        std::vector<CellPrediction> predictions(samples.rows);
+        for(int i = 0; i < samples.rows; ++i)
+            predictions[i] = CellPrediction{static_cast<char>(knnResults.at<float>(i)), 0, 1.0f};
+        return predictions;
+    }
+};
+
+// Leave-one-out accuracy of a classifier: every sample is classified by a model trained on all others.
+// With components > 0 the cells are reduced by a FeatureProjection fitted on the training part only.
+// The time per cell is measured separately by classifying all samples against the full model in one
+// batch (including the projection of the queries).
+void evaluate(const std::string& title, const ClassifierRegistry::Factory& create, const cv::Mat& samples,
+              const cv::Mat& labels, const int components = 0)
+{
+    const int count = samples.rows;
+    int correct = 0;
+    for(int i = 0; i < count; ++i)
+    {
+        cv::Mat otherSamples;
+        cv::Mat otherLabels;
+        if(i > 0)
+        {
+            otherSamples.push_back(samples.rowRange(0, i));
+            otherLabels.push_back(labels.rowRange(0, i));
+        }
+        if(i + 1 < count)
+        {
+            otherSamples.push_back(samples.rowRange(i + 1, count));
+            otherLabels.push_back(labels.rowRange(i + 1, count));
+        }
+
+        cv::Mat query = samples.row(i);
+        if(components > 0)
+        {
+            FeatureProjection projection;
+            if(!projection.fit(otherSamples, cellWidth, cellHeight, components))
+                return;
+            otherSamples = projection.project(otherSamples);
+            query = projection.project(query);
+        }
+
+        std::unique_ptr<DigitClassifier> classifier = create();
+        if(!classifier || !classifier->train(otherSamples, otherLabels))
+            return;
+        const std::vector<CellPrediction> predicted = classifier->classify(query);
+        if(!predicted.empty() && predicted.front().label == labels.at<int>(i))
+            ++correct;
+    }
+
+    FeatureProjection projection;
+    cv::Mat features = samples;
+    if(components > 0)
+    {
+        projection.fit(samples, cellWidth, cellHeight, components);
+        features = projection.project(samples);
+    }
+    std::unique_ptr<DigitClassifier> classifier = create();
+    classifier->train(features, labels);
+
+    const int repetitions = 100;
+    const auto start = std::chrono::steady_clock::now();
+    for(int r = 0; r < repetitions; ++r)
+    {
+        const cv::Mat queries = (components > 0) ? projection.project(samples) : samples;
+        classifier->classify(queries);
+    }
+    const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+    const std::string row = (components > 0) ? title + " (pca " + std::to_string(components) + ")" : title;
+    std::cout << std::left << std::setw(20) << row << std::right
+              << std::setw(6) << correct << "/" << count
+              << std::setw(9) << std::fixed << std::setprecision(1) << 100.0 * correct / count << " %"
+              << std::setw(12) << std::setprecision(0) << ns / (repetitions * count) << " ns/cell"
+              << std::setw(8) << features.cols << " dims" << std::endl;
+}
+
+// Compares the accuracy of all registered classifiers and of the float KNearest on the training files
+int compare(const std::string& classFile, const std::string& trainedFile)
+{
+    cv::Mat classificationImg;
+    cv::Mat trainingImg;
+    if(!readTrainingFiles(classFile, trainedFile, classificationImg, trainingImg))
+        return 1;
+
+    cv::Mat samples;
+    cv::Mat labels;
+    trainingImg.convertTo(samples, CV_8U);
+    classificationImg.reshape(1, static_cast<int>(classificationImg.total())).convertTo(labels, CV_32S);
+    if(samples.rows != labels.rows || samples.rows < 2)
+    {
+        std::cout << "Error: Training images and classification digits do not match!" << std::endl;
+        return 1;
+    }
+
+    std::cout << "Leave-one-out accuracy on " << samples.rows << " samples" << std::endl;
+    for(const std::string& name : ClassifierRegistry::names())
+        evaluate(name, [&name]() { return ClassifierRegistry::create(name); }, samples, labels);
+    evaluate("knn", []() { return ClassifierRegistry::create("knn"); }, samples, labels, defaultComponents);
+
+    // Reference: the float KNearest the registry backends replaced
+    evaluate("KNearest (float)", []() { return std::unique_ptr<DigitClassifier>(new KNearestReference()); }, samples, labels);
+    return 0;
+}
+
+// Converts the xml training files of the interactive training into the binary model format
+// With components > 0 the samples are stored as compact features together with the projection
+int convert(const std::string& classFile, const std::string& trainedFile, const std::string& outputFile, const int components)
+{
+    cv::Mat classificationImg;
+    cv::Mat trainingImg;
+    if(!readTrainingFiles(classFile, trainedFile, classificationImg, trainingImg))
+        return 1;
+
+    if(components > 0)
+    {
+        cv::Mat byteSamples;
+        trainingImg.convertTo(byteSamples, CV_8U);
+        FeatureProjection projection;
+        if(!projection.fit(byteSamples, cellWidth, cellHeight, components))
+        {
+            std::cout << "Error: projection with " << components << " components could not be computed!" << std::endl;
+            return 1;
+        }
+
+        const cv::Mat features = projection.project(byteSamples);
+        if(!ModelFile::write(outputFile, features, classificationImg, cellWidth, cellHeight, projection.mean(), projection.basis()))
+        {
+            std::cout << "Error: model could not be written to " << outputFile << std::endl;
+            return 1;
+        }
+
+        std::cout << "Wrote " << features.rows << " samples (" << features.cols << " pca features, uint8) to "
+                  << outputFile << std::endl;
+        return 0;
+    }
+
+    // Pixels of the training images are whole numbers in [0, 255] --> store them as bytes if lossless
+    cv::Mat samples = trainingImg;
+    cv::Mat byteSamples;
+    trainingImg.convertTo(byteSamples, CV_8U);
+    cv::Mat roundTrip;
+    byteSamples.convertTo(roundTrip, trainingImg.type());
+    if(cv::norm(roundTrip, trainingImg, cv::NORM_L1) == 0.0)
+        samples = byteSamples;
+
+    if(!ModelFile::write(outputFile, samples, classificationImg, cellWidth, cellHeight))
+    {
+        std::cout << "Error: model could not be written to " << outputFile << std::endl;
+        return 1;
+    }
+
+    std::cout << "Wrote " << samples.rows << " samples (" << samples.cols << " values, "
+              << (samples.depth() == CV_8U ? "uint8" : "float32") << ") to " << outputFile << std::endl;
+    return 0;
+}
+
+// Reduces a training set with condensed nearest neighbour (perClass = 0) or per class k-means
+void reduce(const cv::Mat& samples, const cv::Mat& labels, const int perClass, cv::Mat& reduced, cv::Mat& reducedLabels)
+{
+    reduced.release();
+    reducedLabels.release();
+    if(perClass > 0)
+    {
+        Trainer::clusterPrototypes(samples, labels, perClass, reduced, reducedLabels);
+        return;
+    }
+
+    for(const int row : Trainer::condense(samples, labels))
+    {
+        reduced.push_back(samples.row(row));
+        reducedLabels.push_back(labels.row(row));
+    }
+}
+
+// Accuracy/size trade-off of the reduction methods, 2-fold cross validation (even / odd rows)
+void reportReduction(const cv::Mat& samples, const cv::Mat& labels)
+{
+    cv::Mat foldSamples[2];
+    cv::Mat foldLabels[2];
+    for(int i = 0; i < samples.rows; ++i)
+    {
+        foldSamples[i % 2].push_back(samples.row(i));
+        foldLabels[i % 2].push_back(labels.row(i));
+    }
+
+    const int perClassValues[] = {-1, 0, 1, 2, 4, 8};     // -1: all samples, 0: condensed nearest neighbour
+    std::cout << "2-fold accuracy of the reduced training sets (" << samples.rows << " samples)" << std::endl;
+    for(const int perClass : perClassValues)
+    {
+        double accuracy = 0.0;
+        int size = 0;
+        for(int fold = 0; fold < 2; ++fold)
+        {
+            cv::Mat reduced = foldSamples[fold];
+            cv::Mat reducedLabels = foldLabels[fold];
+            if(perClass >= 0)
+                reduce(foldSamples[fold], foldLabels[fold], perClass, reduced, reducedLabels);
+            accuracy += Trainer::accuracy(reduced, reducedLabels, foldSamples[1 - fold], foldLabels[1 - fold]) / 2.0;
+            size += reduced.rows;
+        }
+
+        const std::string name = (perClass < 0) ? "all samples" :
+                                 (perClass == 0) ? "condensed" : "k-means " + std::to_string(perClass) + "/class";
+        std::cout << std::left << std::setw(20) << name << std::right
+                  << std::setw(8) << std::fixed << std::setprecision(1) << size / 2.0 << " samples"
+                  << std::setw(9) << 100.0 * accuracy << " %" << std::endl;
+    }
+}
+
+// Writes the model of the collected training cells: optionally projected to compact features
+// (components > 0) and reduced to prototypes (condensed nearest neighbour or perClass k-means).
+// A classifier with offline trained parameters (e.g. "mlp") is trained on all features and
+// stored in the model as well.
+int buildModel(const Trainer& trainer, const std::string& outputFile, const bool reduceSamples,
+               const int perClass, const int components, const std::string& classifierName)
+{
+    if(trainer.size() < 2)
+    {
+        std::cout << "Error: not enough training cells!" << std::endl;
+        return 1;
+    }
+
+    // The reduction works in the feature space of the model
+    cv::Mat features = trainer.samples();
+    FeatureProjection projection;
+    if(components > 0)
+    {
+        if(!projection.fit(trainer.samples(), cellWidth, cellHeight, components))
+        {
+            std::cout << "Error: projection with " << components << " components could not be computed!" << std::endl;
+            return 1;
+        }
+        features = projection.project(trainer.samples());
+    }
+
+    cv::Mat reduced = features;
+    cv::Mat reducedLabels = trainer.labels();
+    if(reduceSamples)
+    {
+        reportReduction(features, trainer.labels());
+        reduce(features, trainer.labels(), perClass, reduced, reducedLabels);
+    }
+
+    ModelPayloads parameters;
+    if(!classifierName.empty())
+    {
+        std::unique_ptr<DigitClassifier> classifier = ClassifierRegistry::create(classifierName);
+        const auto start = std::chrono::steady_clock::now();
+        if(!classifier || !classifier->train(features, trainer.labels()))
+        {
+            std::cout << "Error: classifier " << classifierName << " could not be trained!" << std::endl;
+            return 1;
+        }
+        const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        parameters = classifier->parameters();
+        std::cout << classifierName << ": trained on " << features.rows << " cells in " << std::fixed << std::setprecision(0)
+                  << ms << " ms, " << (parameters.empty() ? "nothing" : std::to_string(parameters.size()) + " sections")
+                  << " to store" << std::endl;
+    }
+
+    const bool written = projection.empty() ?
+        ModelFile::write(outputFile, reduced, reducedLabels, cellWidth, cellHeight, cv::Mat(), cv::Mat(), parameters) :
+        ModelFile::write(outputFile, reduced, reducedLabels, cellWidth, cellHeight, projection.mean(), projection.basis(), parameters);
+    if(!written)
+    {
+        std::cout << "Error: model could not be written to " << outputFile << std::endl;
+        return 1;
+    }
+
+    std::cout << "Wrote " << reduced.rows << " of " << trainer.size() << " samples";
+    if(reduceSamples)
+        std::cout << " (" << (perClass > 0 ? "k-means prototypes" : "condensed") << ")";
+    std::cout << " to " << outputFile << std::endl;
+    return 0;
+}
+
+// Parses the model options starting at argv[first]; input options are handled by the caller
+bool parseModelOption(int argc, char *argv[], int& i, bool& reduceSamples, int& perClass, int& components,
+                      std::string& classifierName)
+{
+    const std::string option = argv[i];
+    if(option == "--condense")
+        reduceSamples = true;
+    else if(option == "--kmeans" && i + 1 < argc)
+    {
+        reduceSamples = true;
+        perClass = std::atoi(argv[++i]);
+    }
+    else if(option == "--pca")
+        components = (i + 1 < argc && argv[i + 1][0] != '-') ? std::atoi(argv[++i]) : defaultComponents;
+    else if(option == "--classifier" && i + 1 < argc)
+        classifierName = argv[++i];
+    else
+        return false;
+    return true;
+}
+
+// Headless training: collects labelled cells from manifests, cell directories and xml files
+int train(int argc, char *argv[])
+{
+    Trainer trainer(cellWidth, cellHeight);
+    const std::string outputFile = argv[2];
+    bool reduceSamples = false;
+    int perClass = 0;
+    int components = 0;
+    std::string classifierName;
+
+    for(int i = 3; i < argc; ++i)
+    {
+        const std::string option = argv[i];
+        bool ok = true;
+        if(option == "--manifest" && i + 1 < argc)
+            ok = trainer.readManifest(argv[++i]);
+        else if(option == "--cells" && i + 1 < argc)
+            ok = trainer.addCellDirectory(argv[++i]);
+        else if(option == "--synthetic" && i + 1 < argc)
+        {
+            const int samplesPerDigit = std::atoi(argv[++i]);
+            const auto start = std::chrono::steady_clock::now();
+            trainer.addSynthetic(samplesPerDigit);
+            const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            std::cout << "synthetic: " << 9 * samplesPerDigit << " cells in " << std::fixed << std::setprecision(0)
+                      << ms << " ms" << std::endl;
+        }
+        else if(option == "--xml" && i + 2 < argc)
+        {
+            ok = trainer.readTrainingFiles(argv[i + 1], argv[i + 2]);
+            i += 2;
+        }
+        else if(!parseModelOption(argc, argv, i, reduceSamples, perClass, components, classifierName))
+        {
+            printUsage();
+            return 1;
+        }
+
+        if(!ok)
+            return 1;
+    }
+
+    return buildModel(trainer, outputFile, reduceSamples, perClass, components, classifierName);
+}
+}
+
+int main(int argc, char *argv[])
+{
+    if(argc >= 3 && std::string(argv[1]) == "train")
+        return train(argc, argv);
+
+    if(argc >= 5 && std::string(argv[1]) == "condense")
+    {
+        bool reduceSamples = true;
+        int perClass = 0;
+        int components = 0;
+        std::string classifierName;
+        for(int i = 5; i < argc; ++i)
+        {
+            if(!parseModelOption(argc, argv, i, reduceSamples, perClass, components, classifierName))
+            {
+                printUsage();
+                return 1;
+            }
+        }
+
+        Trainer trainer(cellWidth, cellHeight);
+        if(!trainer.readTrainingFiles(argv[2], argv[3]))
+            return 1;
+        return buildModel(trainer, argv[4], true, perClass, components, classifierName);
+    }
+
+    if(argc == 5 && std::string(argv[1]) == "convert")
+        return convert(argv[2], argv[3], argv[4], 0);
+    if(argc == 6 && std::string(argv[1]) == "convert" && std::string(argv[5]) == "--pca")
+        return convert(argv[2], argv[3], argv[4], defaultComponents);
+    if(argc == 7 && std::string(argv[1]) == "convert" && std::string(argv[5]) == "--pca")
+        return convert(argv[2], argv[3], argv[4], std::atoi(argv[6]));
+    if(argc == 4 && std::string(argv[1]) == "compare")
+        return compare(argv[2], argv[3]);
+
+    printUsage();
+    return 1;
+}